@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+
+namespace operations_research {
+namespace sat {
+
+// the replacement operators cost an atomic increment per allocation in every binary, they are
+// only compiled with LITHO_COUNT_ALLOCATIONS (cmake -DLITHO_COUNT_ALLOCATIONS=ON)
+#ifdef LITHO_COUNT_ALLOCATIONS
+constexpr bool ALLOCATIONS_COUNTED = true;
+#else
+constexpr bool ALLOCATIONS_COUNTED = false;
+#endif
+
+// number of calls to the global operator new (and new[]) since the start of the process, counted
+// by the replacement operators of alloc_counter.cpp. the aligned allocations are not counted. 0
+// without LITHO_COUNT_ALLOCATIONS
+std::size_t allocation_count();
+
+}   // namespace sat
+}   // namespace operations_research
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+
+#include "ortools/sat/cp_model.h"
+#include "ortools/sat/model.h"
+
+#include "types.hpp"
+
+namespace operations_research {
+namespace sat {
+
+// a solve running on a background thread, started by solve_model_async. the model and the
+// builder given to solve_model_async must outlive the handle. destroying the handle cancels the
+// solve and waits for it
+class SolveHandle
+{
+public:
+    SolveHandle(Model& model, const CpModelBuilder& cp_model, std::stop_token stop_token);
+    ~SolveHandle();
+
+    SolveHandle(const SolveHandle&)            = delete;
+    SolveHandle& operator=(const SolveHandle&) = delete;
+
+    // the best solution found so far, none before the first one
+    std::optional<CpSolverResponse> best_solution() const;
+
+    bool done() const;
+
+    // true if the solve ended within the timeout
+    bool wait_for(std::chrono::milliseconds timeout) const;
+
+    // the final response, after the end of the solve
+    const CpSolverResponse& wait() const;
+
+    // set the stop flag of the model: the solver stops at its next limit check and returns its
+    // best solution, as at the time limit
+    void cancel();
+
+private:
+    std::atomic<bool>               own_stop_ = false;
+    std::atomic<bool>*              stop_;   // the stop flag of the model, own_stop_ if none
+    mutable std::mutex              mutex_;
+    mutable std::condition_variable finished_;
+    bool                            done_ = false;
+    std::optional<CpSolverResponse> best_solution_;
+    CpSolverResponse                response_;
+
+    std::stop_callback<std::function<void()>> stop_callback_;   // of the caller stop token
+
+    std::jthread thread_;   // last, it is joined before the state above is destroyed
+};
+
+// start the solve of the model on a background thread, as solve_model(model, cp_model). the solve
+// is cancelled by the handle, or by a stop request on stop_token
+std::unique_ptr<SolveHandle> solve_model_async(Model& model, const CpModelBuilder& cp_model,
+                                               std::stop_token stop_token = {});
+
+}   // namespace sat
+}   // namespace operations_research
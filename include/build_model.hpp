@@ -2,21 +2,69 @@
 
 #include "ortools/sat/cp_model.h"
 #include "types.hpp"
+#include <set>
+#include <string>
 #include <vector>
 
 namespace operations_research {
 namespace sat {
 
-CpModelBuilder build_model();
+// build the complete model: vars, constraints and the objective
+void build_model(CpModelBuilder& cp_model, TaskVars& task_vars, ModelIndex& model_index,
+                 std::vector<IntVar>& obj_exprs, const InstData& inst_data,
+                 const BuildOptions& options);
 
+// estimated size of the model built with the arc limits and the sequencing formulation: the
+// proto, the TaskVars maps, the names and the task setup matrix of the changeover table, the
+// solver copies are not counted. the rank formulation has no machine circuit arcs
+ModelSizeEstimate estimate_model_size(
+    const InstData& inst_data, const ArcLimits& arc_limits,
+    SequencingFormulation formulation = SequencingFormulation::Circuit);
+
+// reserve the variables and constraints of the proto for the estimated model, so the pointer
+// arrays of the repeated fields are not regrown while building. each message is still allocated
+// on its own, this saves O(log n) reallocations and copies, not the per message allocations
+void reserve_model_proto(CpModelBuilder& cp_model, const ModelSizeEstimate& estimate);
+
+// the degradation steps needed to fit the estimated model in options.memory_budget
+BuildPlan plan_model_build(const InstData& inst_data, const BuildOptions& options);
+
+// the instance with each job of the schedule only on its scheduled machine
+InstData fix_machine_assignment(const InstData& inst_data, const Schedule& schedule);
+
+std::size_t peak_rss_bytes();   // peak resident set size of the process
+// size of the proto, peak RSS and allocations so far
+void        print_build_phase(const std::string& phase, const CpModelBuilder& cp_model);
+
+// hint the presence, times, sharing count and position of the tasks in the schedule, and the
+// recorded adjacency literals between them
+void add_solution_hint(CpModelBuilder& cp_model, const TaskVars& task_vars,
+                       const Schedule& schedule);
+
+// keep only the dedicated machine of the dedicated jobs
 void filter_tasks(const std::map<TaskID, TimeStamp>& all_task_ptime_map, InstData& inst_data);
 
+// heuristic: remove the alternatives of a job whose processing time, changeovers, first reticle
+// transfer and calendar are never better than on another of its machines, returns the number of
+// removed tasks. the optimum may be lost: the comparison is per task, and moving a job to its
+// faster machine can delay the other jobs of that machine (three jobs of 1 on A and 2 on B:
+// makespan 3 without B, 2 with it). only applied by build_model with
+// BuildOptions::prune_slow_alternatives, rebuild the changeover table after it
+int prune_slow_alternatives(InstData& inst_data);
+
+// the reticles whose sharing count can exceed their limit under any usage rule: the initial
+// usage plus the jobs of the reticle is above the limit
+std::set<ReticleID> find_binding_reticles(const InstData& inst_data);
+
 TimeStamp find_max_horizon(const InstData& inst_data);
 
 std::map<MachineID, TimeStamp> find_machine_max_transfer_time(const InstData& inst_data);
 
 std::map<TaskID, TimeStamp> find_task_max_setup_time(const InstData& inst_data);
 
+// [0, horizon] without the starts that make the task overlap a downtime of its machine
+Domain find_task_start_domain(const InstData& inst_data, TaskID task_id, TimeStamp horizon);
+
 void add_task_transfer_vars(CpModelBuilder& cp_model, TaskVars& task_vars,
                             const InstData& inst_data);
 
@@ -28,6 +76,12 @@ void add_task_start_vars(CpModelBuilder& cp_model, TaskVars& task_vars, const In
 void add_task_end_vars(CpModelBuilder& cp_model, TaskVars& task_vars, const InstData& inst_data,
                        TimeStamp horizon);
 
+void add_job_start_vars(CpModelBuilder& cp_model, TaskVars& task_vars, const InstData& inst_data,
+                        TimeStamp horizon);
+
+void add_job_end_vars(CpModelBuilder& cp_model, TaskVars& task_vars, const InstData& inst_data,
+                      TimeStamp horizon);
+
 void add_task_presence_vars(CpModelBuilder& cp_model, TaskVars& task_vars,
                             const InstData& inst_data);
 
@@ -40,25 +94,51 @@ void add_reticle_sharing_vars(CpModelBuilder& cp_model, TaskVars& task_vars,
 void add_task_position_vars(CpModelBuilder& cp_model, TaskVars& task_vars,
                             const InstData& inst_data);
 
+void add_search_strategy(CpModelBuilder& cp_model, const TaskVars& task_vars);
+
 // **************************************************************************
 void add_task_precense_constraints(CpModelBuilder& cp_model, const TaskVars& task_vars);
 
+void add_job_time_constraints(CpModelBuilder& cp_model, const TaskVars& task_vars);
+
 void add_job_release_time_constraints(CpModelBuilder& cp_model, const TaskVars& task_vars,
-                                      const InstData& inst_data);
+                                      const InstData& inst_data, ModelIndex& model_index);
+
+// start of each later layer of a lot >= end of its previous layer + min queue time
+void add_job_route_constraints(CpModelBuilder& cp_model, const TaskVars& task_vars,
+                               const InstData& inst_data);
 
 void add_reticle_max_sharing_constraints(CpModelBuilder& cp_model, const TaskVars& task_vars,
                                          const InstData& inst_data);
 
-void add_machine_no_overlap_constraints(CpModelBuilder& cp_model, const TaskVars& task_vars);
+void add_machine_no_overlap_constraints(CpModelBuilder& cp_model, const TaskVars& task_vars,
+                                        const InstData& inst_data);
 
 void add_reticle_no_overlap_constraints(CpModelBuilder& cp_model, const TaskVars& task_vars,
                                         const InstData& inst_data);
 
-void add_setup_constraints(CpModelBuilder& cp_model, const TaskVars& task_vars,
-                           const InstData& inst_data);
+void add_setup_constraints(CpModelBuilder& cp_model, TaskVars& task_vars,
+                           const InstData& inst_data, const ArcLimits& arc_limits = ArcLimits());
 
-void add_transfer_constraints(CpModelBuilder& cp_model, const TaskVars& task_vars,
-                              const InstData& inst_data);
+// the present tasks of each machine are ranked 0 .. n - 1 by the task position vars. each task
+// picks its predecessor, the task at the rank before it, and its setup is bounded by an element
+// constraint over its row of the changeover table: O(n^2) per machine
+void add_setup_constraints_by_rank(CpModelBuilder& cp_model, TaskVars& task_vars,
+                                   const InstData& inst_data, TimeStamp horizon);
+
+// the reticle circuits, and under ReticleUsageRule::Campaign the reticle counts along them, with
+// the requalification of the binding reticles
+void add_transfer_constraints(CpModelBuilder& cp_model, TaskVars& task_vars,
+                              const InstData& inst_data, const ArcLimits& arc_limits = ArcLimits());
+
+void add_transfer_constraints_by_id(CpModelBuilder& cp_model, TaskVars& task_vars,
+                                    const InstData&  inst_data,
+                                    const ArcLimits& arc_limits = ArcLimits());
+
+// at most capacity reticles in flight at once, over the moves recorded by the transfer
+// constraints
+void add_transport_capacity_constraints(CpModelBuilder& cp_model, TaskVars& task_vars,
+                                        int capacity);
 
 // **************************************************************************
 void add_obj_minimize_makespan(CpModelBuilder& cp_model, const TaskVars& task_vars,
@@ -71,7 +151,8 @@ void add_obj_minimize_setup_time(CpModelBuilder& cp_model, const TaskVars& task_
                                  std::vector<IntVar>& obj_exprs, TimeStamp horizon);
 
 void add_obj_minimize_tardiness(CpModelBuilder& cp_model, const TaskVars& task_vars,
-                                std::vector<IntVar>& obj_exprs, const InstData& inst_data);
+                                std::vector<IntVar>& obj_exprs, const InstData& inst_data,
+                                ModelIndex& model_index);
 
 }   // namespace sat
 }   // namespace operations_research
\ No newline at end of file
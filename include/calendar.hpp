@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vector>
+
+#include "types.hpp"
+
+namespace operations_research {
+namespace sat {
+
+// sort the windows and merge the overlapping or touching ones
+std::vector<TimeWindow> merge_time_windows(std::vector<TimeWindow> windows);
+
+// earliest start >= start such that [start, start + duration) does not overlap a downtime of the
+// machine
+TimeStamp find_available_start(const InstData& inst_data, MachineID machine_id, TimeStamp start,
+                               TimeDuration duration);
+
+// length of the overlap of [start, end) with the downtimes of the machine
+TimeDuration find_downtime_overlap(const InstData& inst_data, MachineID machine_id,
+                                   TimeStamp start, TimeStamp end);
+
+}   // namespace sat
+}   // namespace operations_research
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "types.hpp"
+
+namespace operations_research {
+namespace sat {
+
+// fill inst_data.changeovers from the tasks, setup times and transfer times of the instance. the
+// task x task setup matrix is only stored when it takes at most max_task_setup_bytes
+void build_changeover_table(InstData&   inst_data,
+                            std::size_t max_task_setup_bytes = MAX_TASK_SETUP_BYTES);
+
+}   // namespace sat
+}   // namespace operations_research
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "types.hpp"
+
+namespace operations_research {
+namespace sat {
+
+struct DecompositionOptions
+{
+    int time_limit             = 60;   // seconds, for the whole decomposition
+    int num_search_workers     = 16;
+    int max_iterations         = 20;
+    int master_time_limit      = 5;   // seconds, per iteration
+    int subproblem_time_limit  = 5;   // seconds, per iteration
+    int min_subproblem_workers = 2;   // search workers of each concurrent subproblem solve
+};
+
+struct DecompositionResult
+{
+    Schedule schedule;
+    int64_t  objective    = -1;   // -1 when no feasible schedule
+    int64_t  lower_bound  = 0;    // best bound of the master problems
+    int      iterations   = 0;
+    int      num_cuts     = 0;    // optimality cuts
+    int      num_no_goods = 0;
+};
+
+// logic-based Benders decomposition. a master problem assigns the jobs to the machines with load
+// and changeover estimates, and a tardiness estimate per machine. the machines are then sequenced
+// in parallel, each by the full model on its assigned jobs only, without the reticle moves to the
+// other machines: their bounds are optimality cuts for the master when the assignment is worse
+// than estimated, and a no-good cut when the assignment is infeasible. the best assignment of the
+// iterations (by the greedy schedule on it) is finally solved with the full model. the cuts need
+// a machine to never get cheaper with more jobs, so the subproblems use the shortest path closure
+// of the setups and transfers (a relaxation that meets the triangle inequality). the subproblems
+// run on a bounded number of threads, each with min_subproblem_workers search workers or more
+DecompositionResult solve_by_decomposition(const InstData&             inst_data,
+                                           const DecompositionOptions& options);
+
+void print_decomposition_result(const DecompositionResult& result);
+
+}   // namespace sat
+}   // namespace operations_research
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "types.hpp"
+
+namespace operations_research {
+namespace sat {
+
+struct DeterminismReport
+{
+    int    runs                   = 0;
+    bool   identical              = true;   // same status, objective and solution in all the runs
+    double min_deterministic_time = 0;
+    double max_deterministic_time = 0;
+    double min_wall_time          = 0;
+    double max_wall_time          = 0;
+};
+
+// solve the same instance several times in deterministic mode, and compare the responses
+DeterminismReport check_determinism(const InstData& inst_data, int runs, int num_search_workers,
+                                    int random_seed, double deterministic_time_limit);
+
+void print_determinism_report(const DeterminismReport& report);
+
+}   // namespace sat
+}   // namespace operations_research
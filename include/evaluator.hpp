@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "types.hpp"
+
+namespace operations_research {
+namespace sat {
+
+enum class ViolationType
+{
+    MissingJob,       // a job of the instance is not scheduled
+    DuplicateJob,     // a job is scheduled more than once
+    InvalidMachine,   // the job can not be processed on the machine
+    ProcessingTime,   // end - start != processing time
+    ReleaseTime,      // start < release time
+    MachineOverlap,   // two tasks overlap on the same machine
+    ReticleOverlap,   // two tasks overlap on the same reticle
+    Changeover,       // not enough time for the setup and transfer before the task
+    ReticleSharing,   // the reticle sharing count exceeds the limit
+    MachineDowntime,  // the task is processed during a downtime of the machine
+    QueueTime,        // start < end of the previous layer of the lot + min queue time
+    UnknownJob,       // the job is not in the instance, the task is left out of the other checks
+};
+
+struct Violation
+{
+    ViolationType type;
+    JobID         job_id;
+    int64_t       amount;   // missing time, or sharing count over the limit
+};
+
+struct Evaluation
+{
+    int64_t makespan             = 0;
+    int64_t total_tardiness      = 0;
+    int64_t objective            = 0;   // makespan + total tardiness, the objective of build_model
+    int64_t total_setup          = 0;   // required setup times
+    int64_t total_transfer       = 0;   // required transfer times
+    int     num_setups           = 0;
+    int     num_transfers        = 0;
+    int     num_requalifications = 0;   // under ReticleUsageRule::Campaign
+
+    std::vector<Violation> violations;
+
+    bool feasible() const { return violations.empty(); }
+};
+
+// recompute the objective terms and check all the rules of the model for a schedule, from the
+// start time, end time and machine of each task only. runs in O(n log n)
+Evaluation evaluate_schedule(const Schedule& schedule, const InstData& inst_data);
+
+// with the release and due times given apart from the instance, e.g. those of a scenario patched
+// on a shared base instance
+Evaluation evaluate_schedule(const Schedule& schedule, const InstData& inst_data,
+                             const std::map<JobID, TimeStamp>& release_times,
+                             const std::map<JobID, TimeStamp>& due_times);
+
+// read a schedule in the sol.csv format
+Schedule read_schedule(const std::string& file_name);
+
+const char* violation_name(ViolationType type);
+void        print_evaluation(const Evaluation& evaluation);
+
+}   // namespace sat
+}   // namespace operations_research
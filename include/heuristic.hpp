@@ -0,0 +1,67 @@
+#pragma once
+
+#include <optional>
+
+#include "types.hpp"
+
+namespace operations_research {
+namespace sat {
+
+// machine and reticle state of a schedule that is built by appending the tasks in time order,
+// following the setup, transfer and reticle sharing rules of the model
+class DispatchState
+{
+public:
+    explicit DispatchState(const InstData& inst_data);
+
+    // earliest task of the job appended on the machine, false if the reticle sharing limit would
+    // be exceeded (machine run rule) or the previous layer of the lot is not appended yet. under
+    // the campaign rule, a reticle at its limit is requalified first
+    bool next_task(JobID job_id, MachineID machine_id, ScheduledTask& task) const;
+
+    void append(const ScheduledTask& task);
+
+    // the same next tasks for any job, e.g. two decodes of a schedule met again
+    bool operator==(const DispatchState& other) const = default;
+
+private:
+    struct MachineState
+    {
+        bool      used         = false;
+        TimeStamp available    = 0;   // end of the last task on the machine
+        ReticleID last_reticle = 0;
+        int       last_usage   = 0;
+        int       task_count   = 0;
+
+        bool operator==(const MachineState& other) const = default;
+    };
+
+    struct ReticleState
+    {
+        bool      used      = false;
+        TimeStamp available = 0;   // end of the last task with the reticle
+        MachineID position  = 0;   // machine where the reticle is
+        int       usage     = 0;   // uses since the last requalification, campaign rule
+
+        bool operator==(const ReticleState& other) const = default;
+    };
+
+    const InstData*                           inst_data_;
+    std::map<MachineID, MachineState>         machine_states_;
+    std::map<ReticleID, ReticleState>         reticle_states_;
+    std::map<JobID, std::optional<TimeStamp>> job_ends_;   // of the appended previous layers
+};
+
+// greedy list scheduling: the job that can end first (on its best candidate machine) is appended
+// next, ties broken by the due time. the later layers of a lot become candidates once the previous
+// layer is appended. the jobs that can not be placed are missing from the returned schedule
+Schedule greedy_schedule(const InstData& inst_data);
+
+// list scheduling over a window of the next jobs in release time order: the job of the window
+// that can end first is appended, a later layer joins the window once its previous layer is
+// done. O(n w m log n) for a window of w jobs instead of the O(n^2 m) of greedy_schedule, for
+// the instances too large to model in full
+Schedule dispatch_schedule(const InstData& inst_data);
+
+}   // namespace sat
+}   // namespace operations_research
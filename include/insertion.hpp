@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "types.hpp"
+
+namespace operations_research {
+namespace sat {
+
+// a job that is not in the instance, e.g. a hot lot arriving while the schedule runs
+struct HotLot
+{
+    JobID                             job_id;
+    ReticleID                         reticle_id;
+    TimeStamp                         release_time = 0;
+    TimeStamp                         due_time     = 0;
+    std::map<MachineID, TimeDuration> processing_times;   // the allowed machines
+};
+
+struct Insertion
+{
+    bool          found = false;
+    ScheduledTask task;                  // the inserted task
+    int64_t       objective_delta = 0;   // increase of makespan + total tardiness
+    int           num_candidates  = 0;   // insertion positions evaluated
+};
+
+// insertion of one job into the gaps of a schedule, the other tasks are not moved. a position is
+// a gap between two consecutive tasks of a machine and two consecutive tasks of the reticle: the
+// job starts after the setup and transfer from both predecessors, and both successors keep
+// enough time for their new setup and transfer. the reticle sharing limit is checked on the
+// machine run the job joins (ReticleUsageRule::MachineRun, the campaign counts and
+// requalifications of the later reticle tasks are left to evaluate_schedule). the index is built
+// once for the schedule in O(n log n), a query is linear in the tasks of the allowed machines and
+// of the reticle
+class InsertionEngine
+{
+public:
+    InsertionEngine(const Schedule& schedule, const InstData& inst_data);
+
+    // the insertion with the smallest objective increase, then the earliest end. not found when
+    // the reticle of the lot is unknown to the instance
+    Insertion find_best_insertion(const HotLot& lot) const;
+
+    // the schedule with the insertion, and the positions, changeovers and sharing counts of the
+    // other tasks updated
+    Schedule apply(const Insertion& insertion) const;
+
+private:
+    // the evaluator rules of a task of the schedule: its predecessors on the machine and on the
+    // reticle, and the changeovers it needs after them
+    struct TaskState
+    {
+        int64_t machine_ready = 0;   // end of the machine predecessor
+        int64_t reticle_ready = 0;   // end of the reticle predecessor
+        int64_t machine_setup = 0;   // setup from the reticle of the machine predecessor
+        int64_t transfer      = 0;   // from the previous position of the reticle
+        bool    moved         = false;   // the reticle comes from another machine
+        int     usage         = 1;       // reticle sharing count
+        int     run_usage     = 1;       // sharing count of the last task of its run
+    };
+
+    // start of the task not earlier than ready, outside of the machine downtimes
+    TimeStamp find_start(MachineID machine_id, int64_t ready, TimeDuration duration) const;
+
+    const Schedule*                       schedule_;
+    const InstData*                       inst_data_;
+    std::vector<TaskState>                states_;
+    std::map<MachineID, std::vector<int>> machine_sequences_;   // task indices by start
+    std::map<ReticleID, std::vector<int>> reticle_sequences_;
+    int64_t                               makespan_ = 0;
+};
+
+}   // namespace sat
+}   // namespace operations_research
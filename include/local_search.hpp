@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+#include "types.hpp"
+
+namespace operations_research {
+namespace sat {
+
+enum class Acceptance
+{
+    SimulatedAnnealing,   // one random move per iteration, metropolis acceptance
+    Tabu,                 // best non-tabu move of a random candidate list per iteration
+};
+
+struct LocalSearchOptions
+{
+    Acceptance acceptance          = Acceptance::SimulatedAnnealing;
+    double     time_limit          = 1.0;   // wall time in seconds, for each thread
+    int        num_threads         = 4;     // independent runs, the best result is kept
+    int        random_seed         = 0;     // thread i uses random_seed + i
+    double     initial_temperature = 0.0;   // 0: 2% of the objective of the start schedule
+    int        tabu_tenure         = 10;    // iterations a moved job stays tabu
+    int        tabu_candidates     = 20;    // moves evaluated per tabu iteration
+};
+
+// improve a schedule with insert (machine reassignment), swap and reticle grouping moves on the
+// machine sequences. the sequences are decoded into start times in time order with the rules of
+// DispatchState, a move re-decodes from the first step it can change until the decode meets the
+// previous one again. the returned schedule is never worse than the given one
+Schedule improve_schedule(const Schedule& schedule, const InstData& inst_data,
+                          const LocalSearchOptions& options);
+
+}   // namespace sat
+}   // namespace operations_research
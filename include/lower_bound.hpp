@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+
+#include "ortools/sat/cp_model.h"
+#include "ortools/sat/model.h"
+
+#include "types.hpp"
+
+namespace operations_research {
+namespace sat {
+
+// combinatorial lower bound of the build_model objective (makespan + total tardiness), computed
+// from the instance data only. machine downtimes are ignored, which keeps it valid
+struct LowerBound
+{
+    int64_t job_makespan      = 0;   // earliest end of each job on its best machine
+    int64_t machine_makespan  = 0;   // release-time load bound of the single-machine jobs
+    int64_t reticle_makespan  = 0;   // release-time load bound of the jobs of each reticle
+    int64_t parallel_makespan = 0;   // total work spread over all the machines
+    int64_t makespan          = 0;   // max of the above
+
+    int64_t job_tardiness     = 0;   // sum of the tardiness of each job at its earliest end
+    int64_t machine_tardiness = 0;   // EDD relaxation of the single-machine jobs
+    int64_t reticle_tardiness = 0;   // EDD relaxation of the jobs of each reticle
+    int64_t tardiness         = 0;   // max of the above
+
+    int64_t objective    = 0;   // makespan + tardiness
+    double  compute_time = 0;   // seconds
+};
+
+struct GapReport
+{
+    int64_t objective    = -1;   // of the response, -1 without a solution
+    int64_t solver_bound = 0;    // best_objective_bound of the response
+    int64_t bound        = 0;    // max of the solver and the combinatorial bound
+    double  gap          = 1;    // (objective - bound) / objective
+};
+
+// release time of the job, or the shortest transfer and setup of its reticle to the machine
+int64_t find_earliest_start(const InstData& inst_data, TaskID task_id);
+
+LowerBound compute_lower_bound(const InstData& inst_data);
+
+GapReport compute_gap(const CpSolverResponse& response, const LowerBound& lower_bound);
+
+// stop the solve as soon as the gap of an improving solution to the best of the combinatorial
+// and the solver bound is at most gap_target (e.g. 0.01). stop is registered as an external
+// limit of the model and should outlive the solve
+void add_gap_limit(Model& model, const LowerBound& lower_bound, double gap_target,
+                   std::atomic<bool>& stop);
+
+void print_lower_bound(const LowerBound& lower_bound);
+void print_gap_report(const GapReport& report);
+
+}   // namespace sat
+}   // namespace operations_research
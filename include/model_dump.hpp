@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "ortools/sat/cp_model.h"
+#include "ortools/sat/sat_parameters.pb.h"
+
+#include "types.hpp"
+
+namespace operations_research {
+namespace sat {
+
+// a solve captured for an offline replay: the built model, the parameters it was solved with,
+// the hash of the instance files it was built from and its response, empty (UNKNOWN status) when
+// the bundle was written before the solve and the solve did not return
+struct ModelBundle
+{
+    CpModelProto     model;
+    SatParameters    parameters;
+    uint64_t         input_hash = 0;
+    CpSolverResponse response;
+};
+
+// FNV-1a over the names and contents of the instance files read by read_inst_data, a missing
+// file is hashed as empty
+uint64_t hash_input_files(const std::string& directory = "data");
+
+// binary bundle: magic, version and input hash, then the model, the parameters and the response
+// in the protobuf wire format, each after its byte size
+bool write_model_bundle(const std::string& file_name, const ModelBundle& bundle);
+bool read_model_bundle(const std::string& file_name, ModelBundle& bundle);
+
+// a side by side of the recorded and the replayed solves: status, objective, bound, times and
+// search counters
+void print_replay_diff(const std::string& name, const CpSolverResponse& recorded,
+                       const CpSolverResponse& replayed);
+
+}   // namespace sat
+}   // namespace operations_research
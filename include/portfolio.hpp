@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+
+#include "ortools/sat/cp_model.h"
+
+#include "types.hpp"
+
+namespace operations_research {
+namespace sat {
+
+struct PortfolioResult
+{
+    std::string    winner;   // formulation or heuristic that found the best schedule
+    CpSolverStatus status = CpSolverStatus::UNKNOWN;
+    int64_t        objective = -1;
+    Schedule       schedule;
+};
+
+// race the formulations of build_model on a shared budget of search workers, after the greedy
+// heuristic. the best schedule found so far is shared as solution hint and strict objective upper
+// bound with the formulations that did not start yet, and all the members are stopped as soon as
+// one proves optimality or the time limit is reached
+PortfolioResult run_portfolio(const InstData& inst_data, int num_search_workers, int time_limit);
+
+}   // namespace sat
+}   // namespace operations_research
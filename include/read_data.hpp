@@ -10,11 +10,23 @@ std::map<JobID, TimeStamp>          read_job_release_time_data();
 std::map<JobID, TimeStamp>          read_job_due_time_data();
 std::map<TaskID, TimeStamp>         read_job_processing_time_data();
 std::map<ReticleID, int>            read_reticle_sharing_data();
-std::map<SetupPair, TimeDuration>   read_setup_time_data();
+SetupFamilies                       read_setup_time_data();
 std::map<MachinePair, TimeDuration> read_transfer_time_data();
 std::map<ReticleID, MachineID>      read_reticle_init_positions_data();
 std::map<ReticleID, int>            read_reticle_init_usage();
 std::map<JobID, ReticleID>          read_job_reticle_pair_data();
 
+std::map<MachineID, std::vector<TimeWindow>> read_machine_calendar_data();
+std::map<JobID, RouteStep>                   read_lot_route_data();
+
+// the lot routes between the jobs only: a job follows its nearest previous layer that is in jobs,
+// after the sum of the min queue times of the layers in between
+std::map<JobID, RouteStep> restrict_lot_routes(const std::map<JobID, RouteStep>& job_predecessors,
+                                               const std::set<JobID>&            jobs);
+
+// read all the instance files under data folder, and filter the tasks. the task setup matrix of
+// the changeover table is stored up to max_task_setup_bytes
+InstData read_inst_data(std::size_t max_task_setup_bytes = MAX_TASK_SETUP_BYTES);
+
 }   // namespace sat
 }   // namespace operations_research
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "ortools/sat/cp_model.h"
+
+#include "types.hpp"
+
+namespace operations_research {
+namespace sat {
+
+enum class DeltaType
+{
+    MachineDown,   // the machine is down in [start, end), or for the whole horizon without window
+    ReleaseTime,   // new release time of a job
+    DueTime,       // new due time of a job
+    AddJob,        // a new lot, e.g. a hot lot, with its reticle and processing times
+    RemoveJob,
+};
+
+struct ScenarioDelta
+{
+    DeltaType  type;
+    JobID      job_id     = 0;
+    MachineID  machine_id = 0;
+    ReticleID  reticle_id = 0;
+    TimeStamp  time       = 0;        // release or due time
+    TimeStamp  due_time   = 0;        // of an added job
+    TimeWindow window     = {0, 0};   // {0, 0}: the whole horizon
+
+    std::vector<std::pair<MachineID, TimeStamp>> processing_times;   // of an added job
+};
+
+struct Scenario
+{
+    std::string                name;
+    std::vector<ScenarioDelta> deltas;
+};
+
+struct ScenarioKpis
+{
+    std::string    name;
+    CpSolverStatus status          = CpSolverStatus::UNKNOWN;
+    bool           patched         = false;   // solved on the patched base model
+    bool           feasible        = false;
+    int            dropped_jobs    = 0;   // jobs left without a machine
+    int64_t        objective       = -1;
+    int64_t        makespan        = 0;
+    int64_t        total_tardiness = 0;
+    int64_t        total_setup     = 0;
+    int            num_setups      = 0;
+    int64_t        total_transfer  = 0;
+    int            num_transfers   = 0;
+    double         wall_time       = 0;
+};
+
+// read the scenario deltas, one per line: scenario,delta,arguments
+//   scenario,machine_down,machine[,start,end]
+//   scenario,release,job,time
+//   scenario,due,job,time
+//   scenario,add_job,job,reticle,release,due,machine,processing[,machine,processing...]
+//   scenario,remove_job,job
+// the lines of a scenario are applied in order, the lines starting with # are skipped
+std::vector<Scenario> read_scenarios(const std::string& file_name);
+
+// a copy of the base instance with the deltas applied, the changeover table is only rebuilt when
+// the tasks change. dropped_jobs counts the jobs left without a machine, which are removed. only
+// needed for the scenarios that are not patchable, the others keep the base instance
+InstData apply_scenario(const InstData& base_data, const Scenario& scenario, int& dropped_jobs);
+
+// true when the base model can be patched for the scenario (solve_model.hpp) instead of rebuilt:
+// release and due times, and machines down for the whole horizon without dropping a job whose
+// circuit in the base model has the depot loop (TaskVars::machine_empty_vars)
+bool is_patchable(const InstData& base_data, const TaskVars& base_task_vars,
+                  const Scenario& scenario);
+
+// solve the base instance and the scenarios concurrently. the parsed base instance, its
+// changeover table and its built model are shared, each running solve gets the same share of the
+// threads with at least min_workers search workers, the other scenarios wait for a free slot
+std::vector<ScenarioKpis> run_scenarios(const InstData& base_data,
+                                        const std::vector<Scenario>& scenarios, int num_threads,
+                                        int time_limit, int min_workers = 4);
+
+void print_scenario_table(const std::vector<ScenarioKpis>& rows);   // to std::cout
+void write_scenario_table(const std::vector<ScenarioKpis>& rows, const std::string& file_name);
+
+}   // namespace sat
+}   // namespace operations_research
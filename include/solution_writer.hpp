@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ortools/sat/cp_model.h"
+
+#include "types.hpp"
+
+namespace operations_research {
+namespace sat {
+
+// the present tasks of a solution as columns, in the order of the sol.csv fields
+struct ScheduleColumns
+{
+    std::vector<int32_t> job_id;
+    std::vector<int32_t> machine_id;
+    std::vector<int32_t> reticle_id;
+    std::vector<int32_t> transfer;
+    std::vector<int32_t> setup;
+    std::vector<int32_t> start;
+    std::vector<int32_t> processing;
+    std::vector<int32_t> end;
+    std::vector<int32_t> position;
+    std::vector<int32_t> reticle_usage;
+
+    std::size_t size() const { return job_id.size(); }
+};
+
+// exports the solutions of a built model. the variable indices and the instance data of each task
+// are resolved once, a solution is then extracted in one pass over the response solution vector,
+// fast enough to export each improving solution from a solution observer
+class SolutionExporter
+{
+public:
+    SolutionExporter(const TaskVars& task_vars, const InstData& inst_data);
+
+    const ScheduleColumns& extract(const CpSolverResponse& response);
+    const ScheduleColumns& columns() const { return columns_; }
+
+    // the last extracted solution, written to a temporary file renamed over file_name so that a
+    // reader never sees a partial file
+    void write_csv(const std::string& file_name) const;     // same format as data/sol.csv
+    void write_arrow(const std::string& file_name) const;   // Arrow IPC file format
+
+private:
+    struct TaskIndex
+    {
+        int     presence;   // variable indices in the model
+        int     transfer;
+        int     setup;
+        int     start;
+        int     end;
+        int     position;
+        int     sharing;
+        int32_t job_id;
+        int32_t machine_id;
+        int32_t reticle_id;
+        int32_t processing;
+    };
+
+    std::vector<TaskIndex> tasks_;
+    ScheduleColumns        columns_;
+};
+
+}   // namespace sat
+}   // namespace operations_research
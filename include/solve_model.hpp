@@ -13,7 +13,28 @@ void enable_log_search_progress(SatParameters& parameters);
 void disable_log_search_progress(SatParameters& parameters);
 void add_parameters_to_model(Model& model, SatParameters& parameters);
 
+// fixed seed, interleaved search and fixed search branching, the same model gives the same
+// response for a fixed number of workers, a different number of workers can give a different
+// response. the deterministic time limit replaces the wall time limit. the model should have a
+// decision strategy (BuildOptions::fixed_search_order)
+void set_deterministic_mode(SatParameters& parameters, int random_seed,
+                            double deterministic_time_limit);
+void print_parameters(const SatParameters& parameters);   // to std::cout and data/sol_params.txt
+
 CpSolverResponse solve_model(Model& model, CpModelBuilder& cp_model);
+CpSolverResponse solve_model(Model& model, const CpModelProto& model_proto);
+
+// patch the built model in place (e.g. on cp_model.MutableProto()) for a what-if re-solve,
+// a new Model should be used for each solve
+void patch_job_release_time(CpModelProto& model_proto, const ModelIndex& model_index,
+                            JobID job_id, TimeStamp release_time);
+void patch_job_due_time(CpModelProto& model_proto, const ModelIndex& model_index, JobID job_id,
+                        TimeStamp due_time);
+void patch_task_availability(CpModelProto& model_proto, const TaskVars& task_vars,
+                             TaskID task_id, bool available);
+// all the tasks of the machine absent, and its depot loop (TaskVars::machine_empty_vars) set
+void patch_machine_availability(CpModelProto& model_proto, const TaskVars& task_vars,
+                                MachineID machine_id, bool available);
 
 void print_obj_val(const CpSolverResponse& response);
 void print_response_status(const CpSolverResponse& response);
@@ -21,5 +42,9 @@ void print_response_statistics(const CpSolverResponse& response);
 void print_solution(const CpSolverResponse& response, const TaskVars& task_vars,
                     const InstData& inst_data);
 
+Schedule extract_schedule(const CpSolverResponse& response, const TaskVars& task_vars,
+                          const InstData& inst_data);
+void     print_schedule(const Schedule& schedule);   // to std::cout and data/sol.csv
+
 }   // namespace sat
 }   // namespace operations_research
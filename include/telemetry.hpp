@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "ortools/sat/cp_model.h"
+#include "ortools/sat/model.h"
+
+namespace operations_research {
+namespace sat {
+
+// time series of the solve progress, one row per improving solution and per bound improvement,
+// a sample row every sample interval, and a last row with the final response. all times are
+// seconds since attach on the steady clock. the solver reports the conflicts only with its
+// responses, a sample row repeats the count of the last one. written as JSON lines if the file
+// name ends with .jsonl, as CSV otherwise, and flushed after each row so that a running solve can
+// be charted
+class SolveTelemetry
+{
+public:
+    // lower_bound: a bound of the objective known before the solve (lower_bound.hpp), the gap is
+    // computed with the best of it and the solver bound. sample_interval in seconds, 0: no samples
+    explicit SolveTelemetry(const std::string& file_name, int64_t lower_bound = 0,
+                            double sample_interval = 1.0);
+    ~SolveTelemetry();
+
+    // register the callbacks on the model and start the samples, the telemetry should outlive
+    // the solve
+    void attach(Model& model);
+    void finish(const CpSolverResponse& response);   // stops the samples
+
+private:
+    struct Row
+    {
+        double      time;        // seconds since attach
+        const char* event;       // solution, bound, sample or final
+        int64_t     objective;   // -1 before the first solution
+        int64_t     bound;
+        int         num_solutions;
+        int64_t     num_conflicts;
+        std::string subsolver;   // subsolver of a solution, status of the final row
+    };
+
+    double elapsed() const;   // seconds since attach
+    void   sample_loop();
+    void   stop_sampling();
+    void   write_row(const Row& row);   // with mutex_ held
+
+    std::ofstream                         file_;
+    bool                                  json_lines_;
+    std::mutex                            mutex_;   // the callbacks run on the solver threads
+    std::chrono::steady_clock::time_point start_time_;
+    double                                sample_interval_;
+    std::thread                           sampler_;
+    std::condition_variable               stop_condition_;
+    bool                                  stopped_       = false;
+    int64_t                               objective_     = -1;
+    int64_t                               bound_         = 0;
+    int                                   num_solutions_ = 0;
+    int64_t                               num_conflicts_ = 0;
+};
+
+}   // namespace sat
+}   // namespace operations_research
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <set>
+
 #include "ortools/sat/cp_model.h"
 
 namespace operations_research {
@@ -13,6 +15,7 @@ using TimeStamp    = unsigned int;
 using TimeDuration = unsigned int;
 
 using MachinePair = std::pair<int, int>;   // (from_machine_id, to_machine_id)
+using TimeWindow  = std::pair<TimeStamp, TimeStamp>;   // [start, end)
 using SetupPair   = std::tuple<MachineID, ReticleID,
                              ReticleID>;   // (machine_id, reticle_id_1, reticle_id_2)
 
@@ -39,6 +42,186 @@ struct TaskType
     IntervalVar reticle_interval;
 };
 
+// setup time on a machine after the reticle is transferred from another machine
+constexpr TimeDuration TRANSFER_SETUP_TIME = 2;
+
+// time to requalify a reticle that reached its sharing limit, under ReticleUsageRule::Campaign
+constexpr TimeDuration REQUALIFICATION_TIME = 10;
+
+// what the reticle sharing limit counts
+enum class ReticleUsageRule
+{
+    MachineRun,   // consecutive tasks of the reticle on a machine, another reticle ends the run
+    Campaign,     // all the uses of the reticle since its last requalification, the reticle is
+                  // requalified before its next use when the count reaches the limit
+};
+
+// link of a litho operation to the previous operation of its lot, each layer of a lot is its own
+// job with its own reticle, machines, release and due time
+struct RouteStep
+{
+    JobID        previous_job_id;
+    TimeDuration min_queue_time;   // from the end of the previous operation to the start
+};
+
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+// largest task x task setup matrix stored by the changeover table, without a memory budget
+constexpr std::size_t MAX_TASK_SETUP_BYTES = std::size_t(256) << 20;
+
+template <typename T>
+struct CacheAlignedAllocator
+{
+    using value_type = T;
+
+    CacheAlignedAllocator() = default;
+    template <typename U>
+    CacheAlignedAllocator(const CacheAlignedAllocator<U>&)
+    {}
+
+    T* allocate(std::size_t n)
+    {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(CACHE_LINE_SIZE)));
+    }
+    void deallocate(T* p, std::size_t) { ::operator delete(p, std::align_val_t(CACHE_LINE_SIZE)); }
+
+    bool operator==(const CacheAlignedAllocator&) const = default;
+};
+
+// reticle x reticle setup matrices of the machines. scanners of the same model share their
+// matrix, so each distinct matrix is stored once for its family of machines and the machines are
+// mapped to their family. pairs missing in setup_time.csv cost 0
+class SetupFamilies
+{
+public:
+    SetupFamilies() = default;
+    explicit SetupFamilies(std::size_t num_reticles) : num_reticles_(num_reticles) {}
+
+    TimeDuration get_setup_time(MachineID machine_id, ReticleID from, ReticleID to) const
+    {
+        const int family = get_family(machine_id);
+        if (family < 0 or from >= num_reticles_ or to >= num_reticles_) {
+            return 0;
+        }
+        return matrices_[family][from * num_reticles_ + to];
+    }
+
+    int get_family(MachineID machine_id) const   // -1 if the machine has no setups
+    {
+        return machine_id < machine_families_.size() ? machine_families_[machine_id] : -1;
+    }
+
+    // the row-major matrix of the family
+    const std::vector<TimeDuration>& get_matrix(int family) const { return matrices_[family]; }
+
+    std::size_t num_reticles() const { return num_reticles_; }   // max reticle id + 1
+    std::size_t num_machines() const { return machine_families_.size(); }   // max machine id + 1
+    std::size_t num_families() const { return matrices_.size(); }
+    std::size_t bytes() const;   // of the matrices and the family index
+
+    // the row-major num_reticles x num_reticles matrix of the machine, joins the family with the
+    // same matrix if any
+    void set_matrix(MachineID machine_id, std::vector<TimeDuration> matrix);
+
+private:
+    std::size_t                            num_reticles_ = 0;
+    std::vector<int>                       machine_families_;   // by machine id, -1: no setups
+    std::vector<std::vector<TimeDuration>> matrices_;           // by family
+};
+
+struct InstData;
+
+// changeover costs in flat matrices indexed by the machine and reticle ids, filled from the setup
+// families and the transfer map of InstData by build_changeover_table (changeover.hpp), pairs
+// missing in the data cost 0. the reticle setups are stored once per setup family. the tasks of
+// a machine are numbered by their local index, the position of the job in
+// machine_jobs(machine_id). the setups between the tasks of a machine are a row-major matrix with
+// the rows padded to a cache line, when it fits in the size given to build_changeover_table
+class ChangeoverTable
+{
+public:
+    // setup on the machine from reticle from to reticle to, 0 for the same reticle
+    TimeDuration get_setup_time(MachineID machine_id, ReticleID from, ReticleID to) const
+    {
+        const auto family = machine_families_[machine_id];
+        return reticle_setups_[(family * num_reticles_ + from) * num_reticles_ + to];
+    }
+
+    // transfer of a reticle between two machines, 0 on the same machine
+    TimeDuration get_transfer_time(MachineID from, MachineID to) const
+    {
+        return transfers_[from * num_machines_ + to];
+    }
+
+    bool has_machine(MachineID machine_id) const { return machine_id < num_machines_; }
+    bool has_reticle(ReticleID reticle_id) const { return reticle_id < num_reticles_; }
+    const std::vector<MachineID>& machines() const { return machines_; }
+    const std::vector<JobID>& machine_jobs(MachineID machine_id) const
+    {
+        return blocks_[machine_id].jobs;
+    }
+    int get_local_index(MachineID machine_id, JobID job_id) const;   // -1 if not on the machine
+
+    // setup before local task to when it follows local task from on the machine, from the
+    // reticle setups when the task setup matrix is not stored
+    TimeDuration get_task_setup_time(MachineID machine_id, int from, int to) const
+    {
+        const auto& block = blocks_[machine_id];
+        if (task_setups_.empty()) {
+            return get_setup_time(machine_id, block.reticles[from], block.reticles[to]);
+        }
+        return task_setups_[block.offset + from * block.stride + to];
+    }
+    std::size_t task_setup_bytes() const { return task_setups_.size() * sizeof(TimeDuration); }
+
+    // smallest setup before / after the local task, when it is not the first / last task of the
+    // machine. 0 when the task is alone on the machine
+    TimeDuration get_min_setup_in(MachineID machine_id, int task) const
+    {
+        return blocks_[machine_id].min_setups_in[task];
+    }
+    TimeDuration get_min_setup_out(MachineID machine_id, int task) const
+    {
+        return blocks_[machine_id].min_setups_out[task];
+    }
+
+    // smallest transfer to / from the machine from / to another machine
+    TimeDuration get_min_transfer_in(MachineID machine_id) const
+    {
+        return min_transfers_in_[machine_id];
+    }
+    TimeDuration get_min_transfer_out(MachineID machine_id) const
+    {
+        return min_transfers_out_[machine_id];
+    }
+
+private:
+    friend void build_changeover_table(InstData& inst_data, std::size_t max_task_setup_bytes);
+
+    struct MachineBlock
+    {
+        std::vector<JobID>        jobs;       // in job_id order
+        std::vector<ReticleID>    reticles;   // of the jobs
+        std::size_t               offset = 0;
+        std::size_t               stride = 0;   // row length, multiple of a cache line
+        std::vector<TimeDuration> min_setups_in;
+        std::vector<TimeDuration> min_setups_out;
+    };
+
+    using AlignedDurations = std::vector<TimeDuration, CacheAlignedAllocator<TimeDuration>>;
+
+    std::size_t               num_machines_ = 0;   // max machine id + 1
+    std::size_t               num_reticles_ = 0;   // max reticle id + 1
+    std::vector<MachineID>    machines_;
+    std::vector<MachineBlock> blocks_;            // by machine id
+    std::vector<std::size_t>  machine_families_;  // by machine id, the last family has no setups
+    AlignedDurations          reticle_setups_;    // family x reticle x reticle
+    AlignedDurations          transfers_;
+    AlignedDurations          task_setups_;
+    std::vector<TimeDuration> min_transfers_in_;
+    std::vector<TimeDuration> min_transfers_out_;
+};
+
 struct InstData
 {
     std::map<JobID, MachineID>          job_ded_machines;
@@ -46,11 +229,23 @@ struct InstData
     std::map<JobID, TimeStamp>          job_due_times;
     std::map<JobID, ReticleID>          job_reticle_pairs;
     std::map<TaskID, TimeStamp>         processing_times;
-    std::map<SetupPair, TimeDuration>   setup_times;
+    SetupFamilies                       setup_times;
     std::map<MachinePair, TimeDuration> transfer_times;
     std::map<ReticleID, int>            reticle_sharing_limits;
     std::map<ReticleID, MachineID>      reticle_init_positions;
     std::map<ReticleID, int>            reticle_init_usage;
+
+    // previous operation of the later layers of the multi-visit lots, the jobs without entry are
+    // not constrained by a route
+    std::map<JobID, RouteStep> job_predecessors;
+
+    ReticleUsageRule reticle_usage_rule = ReticleUsageRule::MachineRun;
+
+    // unavailable windows of each machine (maintenance, shifts), sorted and merged
+    std::map<MachineID, std::vector<TimeWindow>> machine_downtimes;
+
+    // built from the maps above, rebuild it after a change of the tasks, setups or transfers
+    ChangeoverTable changeovers;
 };
 
 struct TaskVars
@@ -63,6 +258,112 @@ struct TaskVars
     std::map<TaskID, IntervalVar> task_optional_interval_vars;
     std::map<TaskID, IntVar>      reticle_sharing_vars;
     std::map<TaskID, IntVar>      task_position_vars;
+
+    // job level start / end time, equal to the start / end of the present task
+    std::map<JobID, IntVar> job_start_vars;
+    std::map<JobID, IntVar> job_end_vars;
+
+    // literals of the cross-machine reticle arcs into each task, and the optional interval of
+    // that transfer when the transport capacity is modeled
+    std::map<TaskID, std::vector<BoolVar>> reticle_move_literals;
+    std::map<TaskID, IntervalVar>          task_transfer_interval_vars;
+
+    // adjacency literals of the machine and reticle circuits, (from task, to task), only when
+    // ArcLimits::record_literals
+    std::map<std::pair<TaskID, TaskID>, BoolVar> machine_arc_literals;
+    std::map<std::pair<TaskID, TaskID>, BoolVar> reticle_arc_literals;
+
+    // the sharing count of the task reached the limit of its reticle, the reticle is requalified
+    // before its next use. only under ReticleUsageRule::Campaign, for the binding reticles
+    std::map<TaskID, BoolVar> reticle_limit_vars;
+
+    // depot self-loop of the machine circuit, true when no task of the machine is present. only
+    // with SequencingFormulation::Circuit
+    std::map<MachineID, BoolVar> machine_empty_vars;
+};
+
+// position of the patchable constraints in the CpModelProto, the variable positions are given by
+// the index() of the vars in TaskVars
+struct ModelIndex
+{
+    std::map<JobID, int> job_release_constraints;     // job_start >= release_time
+    std::map<JobID, int> job_tardiness_constraints;   // tardiness = max(0, job_end - due_time)
+};
+
+struct ScheduledTask
+{   // one row of the sol.csv file
+    JobID        job_id;
+    MachineID    machine_id;
+    ReticleID    reticle_id;
+    TimeDuration transfer;
+    TimeDuration setup;
+    TimeStamp    start;
+    TimeDuration processing;
+    TimeStamp    end;
+    int          position;        // position in the job sequence of the machine
+    int          reticle_usage;   // reticle sharing count
+};
+
+using Schedule = std::vector<ScheduledTask>;
+
+enum class TransferFormulation
+{
+    Circuit,     // reticle circuit over local task indices, transfer time >= arc transfer time
+    IdCircuit,   // reticle circuit over global task ids, transfer time == arc transfer time
+};
+
+enum class SequencingFormulation
+{
+    Circuit,   // machine circuit over local task indices, one adjacency literal per task pair
+    Rank,      // rank of each present task on its machine, changeovers by element constraints
+};
+
+struct BuildOptions
+{
+    TransferFormulation   transfer_formulation    = TransferFormulation::Circuit;
+    SequencingFormulation sequencing_formulation  = SequencingFormulation::Circuit;
+    bool                  fixed_search_order      = false;   // branch on the job starts by job id
+    std::size_t           memory_budget           = 0;   // bytes of the built model, 0: no budget
+    int                   transport_capacity      = 0;   // reticles in flight at once, 0: no limit
+    bool                  record_arc_literals     = false;   // keep the adjacency literals
+    bool                  reserve_proto           = true;   // size the proto from the estimate
+    bool                  prune_slow_alternatives = false;   // heuristic, may lose the optimum
+};
+
+// steps taken, in this order, while the estimated model does not fit in the memory budget
+enum class MemoryDegradation
+{
+    None,
+    NoNames,           // the n^2 adjacency literals are not named
+    PrunedArcs,        // circuit arcs only between tasks close in due time order
+    FixedAssignment,   // each job only on the machine given by the dispatch schedule
+};
+
+// arcs of the machine and reticle circuits
+struct ArcLimits
+{
+    bool with_names      = true;    // name the adjacency literals
+    bool record_literals = false;   // keep the adjacency literals in TaskVars
+    int  max_neighbors   = 0;       // arcs only to the tasks within this due time rank, 0: all arcs
+
+    // arcs kept whatever the rank, e.g. those used by a known schedule so it stays feasible
+    std::set<std::pair<TaskID, TaskID>> required_arcs;
+};
+
+struct ModelSizeEstimate
+{
+    int64_t     num_tasks        = 0;
+    int64_t     num_arcs         = 0;   // adjacency literals of the machine and reticle circuits
+    int64_t     num_rank_entries = 0;   // element entries of the rank formulation
+    std::size_t bytes            = 0;   // of the model and of the task setup matrix
+};
+
+struct BuildPlan
+{
+    MemoryDegradation degradation = MemoryDegradation::None;
+    ArcLimits         arc_limits;
+    ModelSizeEstimate estimate;
+    Schedule          schedule;   // dispatch schedule of the pruned / fixed model, if any
 };
 
 }   // namespace sat
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+
+#include "ortools/sat/cp_model.h"
+
+#include "types.hpp"
+
+namespace operations_research {
+namespace sat {
+
+struct WarmStartOptions
+{
+    std::string file_name    = "data/sol.csv";   // schedule of the previous solve
+    TimeStamp   time_shift   = 0;   // time of the previous schedule at the start of this one
+    TimeStamp   freeze_until = 0;   // the lots starting before it are frozen, 0: none
+};
+
+struct WarmStartReport
+{
+    int     carried_jobs              = 0;
+    int     total_jobs                = 0;
+    double  cold_first_solution_time  = -1;   // wall time of the first feasible solution
+    int64_t cold_first_solution_value = -1;
+    double  warm_first_solution_time  = -1;
+    int64_t warm_first_solution_value = -1;
+};
+
+// the previous schedule matched to the instance by job id: the jobs that are gone, the tasks on a
+// machine no longer allowed and the tasks started before the time shift are dropped, the times
+// are shifted and the positions renumbered
+Schedule load_warm_start(const InstData& inst_data, const WarmStartOptions& options);
+
+// hint the previous schedule (the model should be built with record_arc_literals to hint the
+// adjacency literals). the frozen lots are constrained to their machine and start
+void add_warm_start(CpModelBuilder& cp_model, const TaskVars& task_vars,
+                    const Schedule& schedule, const WarmStartOptions& options);
+
+// solve cold and warm until the first feasible solution, and compare the time to get it
+WarmStartReport compare_warm_start(const InstData& inst_data, const WarmStartOptions& options,
+                                   int num_search_workers, int time_limit);
+
+void print_warm_start_report(const WarmStartReport& report);
+
+}   // namespace sat
+}   // namespace operations_research
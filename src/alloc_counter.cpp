@@ -0,0 +1,70 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "alloc_counter.hpp"
+
+#ifdef LITHO_COUNT_ALLOCATIONS
+
+namespace {
+
+std::atomic<std::size_t> num_allocations{0};
+
+void* counted_allocate(std::size_t size)
+{
+    num_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+}   // namespace
+
+// the replacements of the global operators, the nothrow and sized forms forward to these
+void* operator new(std::size_t size)
+{
+    return counted_allocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return counted_allocate(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+#endif   // LITHO_COUNT_ALLOCATIONS
+
+namespace operations_research {
+namespace sat {
+
+std::size_t allocation_count()
+{
+#ifdef LITHO_COUNT_ALLOCATIONS
+    return num_allocations.load(std::memory_order_relaxed);
+#else
+    return 0;
+#endif
+}
+
+}   // namespace sat
+}   // namespace operations_research
@@ -0,0 +1,100 @@
+#include <iostream>
+
+#include "ortools/sat/cp_model.h"
+#include "ortools/sat/model.h"
+#include "ortools/util/time_limit.h"
+
+#include "async_solve.hpp"
+#include "solve_model.hpp"
+#include "types.hpp"
+
+namespace operations_research {
+namespace sat {
+constexpr bool DEBUG = true;
+
+namespace {
+
+// the time limit has one stop flag, shared with e.g. add_gap_limit if already registered
+std::atomic<bool>* find_stop_flag(Model& model, std::atomic<bool>& own_stop)
+{
+    auto* time_limit = model.GetOrCreate<TimeLimit>();
+    if (time_limit->ExternalBooleanAsLimit() == nullptr) {
+        time_limit->RegisterExternalBooleanAsLimit(&own_stop);
+    }
+    return time_limit->ExternalBooleanAsLimit();
+}
+
+}   // namespace
+
+SolveHandle::SolveHandle(Model& model, const CpModelBuilder& cp_model, std::stop_token stop_token)
+    : stop_(find_stop_flag(model, own_stop_))
+    , stop_callback_(stop_token, [this] { cancel(); })
+{
+    // the observer is registered before the solve starts
+    model.Add(NewFeasibleSolutionObserver([this](const CpSolverResponse& response) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        best_solution_ = response;
+    }));
+
+    thread_ = std::jthread([this, &model, &cp_model](std::stop_token thread_stop_token) {
+        std::stop_callback on_stop(thread_stop_token, [this] { cancel(); });
+
+        auto response = SolveCpModel(cp_model.Proto(), &model);
+        if (DEBUG) {
+            std::cout << "Async solve: " << CpSolverStatus_Name(response.status())
+                      << (*stop_ ? " (stopped)" : "") << " after " << response.wall_time() << "s"
+                      << std::endl;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            response_ = std::move(response);
+            done_     = true;
+        }
+        finished_.notify_all();
+    });
+}
+
+SolveHandle::~SolveHandle()
+{
+    cancel();   // the jthread joins after it
+}
+
+std::optional<CpSolverResponse> SolveHandle::best_solution() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return best_solution_;
+}
+
+bool SolveHandle::done() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return done_;
+}
+
+bool SolveHandle::wait_for(std::chrono::milliseconds timeout) const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return finished_.wait_for(lock, timeout, [this] { return done_; });
+}
+
+const CpSolverResponse& SolveHandle::wait() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    finished_.wait(lock, [this] { return done_; });
+    return response_;
+}
+
+void SolveHandle::cancel()
+{
+    *stop_ = true;
+}
+
+std::unique_ptr<SolveHandle> solve_model_async(Model& model, const CpModelBuilder& cp_model,
+                                               std::stop_token stop_token)
+{
+    return std::make_unique<SolveHandle>(model, cp_model, stop_token);
+}
+
+}   // namespace sat
+}   // namespace operations_research
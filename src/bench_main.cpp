@@ -0,0 +1,433 @@
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ortools/sat/cp_model.h"
+#include "ortools/sat/model.h"
+#include "ortools/sat/sat_parameters.pb.h"
+
+#include "build_model.hpp"
+#include "changeover.hpp"
+#include "decomposition.hpp"
+#include "evaluator.hpp"
+#include "heuristic.hpp"
+#include "insertion.hpp"
+#include "local_search.hpp"
+#include "read_data.hpp"
+#include "solve_model.hpp"
+#include "types.hpp"
+#include "warm_start.hpp"
+
+namespace {
+
+using namespace operations_research::sat;
+
+constexpr int NUM_THREADS = 8;   // threads / search workers of every method
+
+struct BenchRow
+{
+    std::string method;
+    int64_t     objective;   // -1 when no feasible schedule
+    double      wall_time;
+};
+
+double seconds_since(std::chrono::steady_clock::time_point start_time)
+{
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+    return elapsed.count();
+}
+
+int64_t schedule_objective(const Schedule& schedule, const InstData& inst_data)
+{
+    const auto evaluation = evaluate_schedule(schedule, inst_data);
+    return evaluation.feasible() ? evaluation.objective : -1;
+}
+
+BenchRow run_cp_sat(const std::string& method, const InstData& inst_data,
+                    const BuildOptions& build_options, int time_limit)
+{
+    const auto start_time = std::chrono::steady_clock::now();
+
+    CpModelBuilder      cp_model;
+    TaskVars            task_vars;
+    ModelIndex          model_index;
+    std::vector<IntVar> obj_exprs;
+    build_model(cp_model, task_vars, model_index, obj_exprs, inst_data, build_options);
+
+    Model         model;
+    SatParameters parameters;
+    set_time_limit(parameters, time_limit);
+    set_num_search_workers(parameters, NUM_THREADS);
+    disable_log_search_progress(parameters);
+    add_parameters_to_model(model, parameters);
+    const auto response = solve_model(model, cp_model);
+
+    int64_t objective = -1;
+    if (response.status() == CpSolverStatus::OPTIMAL or
+        response.status() == CpSolverStatus::FEASIBLE) {
+        objective = response.objective_value();
+    }
+    return {method, objective, seconds_since(start_time)};
+}
+
+// each job of the greedy schedule taken out and inserted back as a hot lot, the objective column
+// is the worst objective after the insertions and the wall time is the slowest query
+std::vector<BenchRow> bench_hot_lot(const InstData& inst_data, int)
+{
+    const auto start_time = std::chrono::steady_clock::now();
+    const auto schedule   = greedy_schedule(inst_data);
+    std::vector<BenchRow> rows = {
+        {"greedy", schedule_objective(schedule, inst_data), seconds_since(start_time)}};
+
+    int64_t worst_objective = 0;
+    double  slowest_query   = 0;
+    for (std::size_t index = 0; index < schedule.size(); ++index) {
+        auto       remaining = schedule;
+        const auto task      = remaining[index];
+        remaining.erase(remaining.begin() + index);
+
+        HotLot lot;
+        lot.job_id       = task.job_id;
+        lot.reticle_id   = task.reticle_id;
+        lot.release_time = inst_data.job_release_times.at(task.job_id);
+        lot.due_time     = inst_data.job_due_times.at(task.job_id);
+        for (const auto& [task_id, processing_time] : inst_data.processing_times) {
+            if (task_id.first == task.job_id) {
+                lot.processing_times[task_id.second] = processing_time;
+            }
+        }
+
+        const InsertionEngine engine(remaining, inst_data);
+        const auto            query_time = std::chrono::steady_clock::now();
+        const auto            insertion  = engine.find_best_insertion(lot);
+        slowest_query                    = std::max(slowest_query, seconds_since(query_time));
+
+        const auto objective =
+            insertion.found ? schedule_objective(engine.apply(insertion), inst_data) : -1;
+        worst_objective = objective < 0 or worst_objective < 0
+                              ? -1
+                              : std::max(worst_objective, objective);
+    }
+    rows.push_back({"hot lot insertion", worst_objective, slowest_query});
+    return rows;
+}
+
+// random setup lookups in the per-machine map the loader used to build, and in the setup
+// families. the objective column is the sum of the looked up setups, the same for both
+std::vector<BenchRow> bench_setup_lookup(const InstData& inst_data, int)
+{
+    constexpr int num_lookups = 10000000;
+
+    const auto& setup_families = inst_data.setup_times;
+    const auto  num_machines   = setup_families.num_machines();
+    const auto  num_reticles   = setup_families.num_reticles();
+    if (num_machines == 0 or num_reticles == 0) {
+        return {};
+    }
+
+    std::map<SetupPair, TimeDuration> setup_map;
+    for (MachineID machine_id = 0; machine_id < num_machines; ++machine_id) {
+        for (ReticleID from = 0; from < num_reticles; ++from) {
+            for (ReticleID to = 0; to < num_reticles; ++to) {
+                setup_map[{machine_id, from, to}] =
+                    setup_families.get_setup_time(machine_id, from, to);
+            }
+        }
+    }
+
+    std::mt19937             generator(0);
+    std::vector<SetupPair>   lookups;
+    lookups.reserve(num_lookups);
+    for (int i = 0; i < num_lookups; ++i) {
+        lookups.push_back({static_cast<MachineID>(generator() % num_machines),
+                           static_cast<ReticleID>(generator() % num_reticles),
+                           static_cast<ReticleID>(generator() % num_reticles)});
+    }
+
+    std::vector<BenchRow> rows;
+    auto                  start_time = std::chrono::steady_clock::now();
+    int64_t               sum        = 0;
+    for (const auto& setup_pair : lookups) {
+        sum += setup_map.at(setup_pair);
+    }
+    rows.push_back({"setup map", sum, seconds_since(start_time)});
+
+    start_time = std::chrono::steady_clock::now();
+    sum        = 0;
+    for (const auto& [machine_id, from, to] : lookups) {
+        sum += setup_families.get_setup_time(machine_id, from, to);
+    }
+    rows.push_back({"setup families", sum, seconds_since(start_time)});
+    return rows;
+}
+
+// greedy + local search against CP-SAT, both with the same wall time and threads
+std::vector<BenchRow> bench_local_search(const InstData& inst_data, int time_limit)
+{
+    std::vector<BenchRow> rows;
+
+    auto start_time = std::chrono::steady_clock::now();
+    auto schedule   = greedy_schedule(inst_data);
+    rows.push_back({"greedy", schedule_objective(schedule, inst_data), seconds_since(start_time)});
+
+    for (const auto acceptance : {Acceptance::SimulatedAnnealing, Acceptance::Tabu}) {
+        start_time = std::chrono::steady_clock::now();
+        LocalSearchOptions options;
+        options.acceptance  = acceptance;
+        options.time_limit  = time_limit;
+        options.num_threads = NUM_THREADS;
+        const auto improved = improve_schedule(greedy_schedule(inst_data), inst_data, options);
+        rows.push_back({acceptance == Acceptance::Tabu ? "greedy+tabu" : "greedy+annealing",
+                        schedule_objective(improved, inst_data),
+                        seconds_since(start_time)});
+    }
+
+    rows.push_back(run_cp_sat("cp-sat", inst_data, BuildOptions(), time_limit));
+    return rows;
+}
+
+// the jobs of the instance copied until num_jobs, with their machines, reticles, processing times,
+// release and due times, without routes and sharing limit, to compare the methods on many lots
+InstData make_many_lots_instance(const InstData& inst_data, int num_jobs)
+{
+    std::map<JobID, std::vector<std::pair<MachineID, TimeStamp>>> job_tasks;
+    for (const auto& [task_id, processing_time] : inst_data.processing_times) {
+        job_tasks[task_id.first].push_back({task_id.second, processing_time});
+    }
+
+    InstData many_data = inst_data;
+    many_data.job_ded_machines.clear();
+    many_data.job_release_times.clear();
+    many_data.job_due_times.clear();
+    many_data.job_reticle_pairs.clear();
+    many_data.processing_times.clear();
+    many_data.job_predecessors.clear();
+    if (job_tasks.empty()) {
+        return many_data;
+    }
+
+    auto source = job_tasks.begin();
+    for (JobID job_id = 0; job_id < static_cast<JobID>(num_jobs); ++job_id, ++source) {
+        if (source == job_tasks.end()) {
+            source = job_tasks.begin();
+        }
+        const auto from                     = source->first;
+        many_data.job_release_times[job_id] = inst_data.job_release_times.at(from);
+        many_data.job_due_times[job_id]     = inst_data.job_due_times.at(from);
+        many_data.job_reticle_pairs[job_id] = inst_data.job_reticle_pairs.at(from);
+        if (inst_data.job_ded_machines.contains(from)) {
+            many_data.job_ded_machines[job_id] = inst_data.job_ded_machines.at(from);
+        }
+        for (const auto& [machine_id, processing_time] : source->second) {
+            many_data.processing_times[{job_id, machine_id}] = processing_time;
+        }
+    }
+    // the assignments are compared, not the sharing limits
+    for (auto& [reticle_id, limit] : many_data.reticle_sharing_limits) {
+        limit = num_jobs + many_data.reticle_init_usage.at(reticle_id);
+    }
+    build_changeover_table(many_data);
+    return many_data;
+}
+
+// the monolithic model against the assignment-then-sequencing decomposition, on the instance and
+// on 1000 lots
+std::vector<BenchRow> bench_decomposition(const InstData& inst_data, int time_limit)
+{
+    std::vector<BenchRow> rows;
+    const auto            many_data = make_many_lots_instance(inst_data, 1000);
+    for (const auto* data : {&inst_data, &many_data}) {
+        const std::string suffix = data == &inst_data ? "" : " 1000 lots";
+        rows.push_back(run_cp_sat("cp-sat" + suffix, *data, BuildOptions(), time_limit));
+
+        const auto           start_time = std::chrono::steady_clock::now();
+        DecompositionOptions options;
+        options.time_limit         = time_limit;
+        options.num_search_workers = NUM_THREADS;
+        const auto result          = solve_by_decomposition(*data, options);
+        print_decomposition_result(result);
+        rows.push_back({"decomposition" + suffix, result.objective, seconds_since(start_time)});
+    }
+    return rows;
+}
+
+// the circuit model without and with a transport capacity on the reticle moves
+std::vector<BenchRow> bench_transport(const InstData& inst_data, int time_limit)
+{
+    std::vector<BenchRow> rows;
+    for (const int capacity : {0, 3, 2, 1}) {
+        BuildOptions build_options;
+        build_options.transport_capacity = capacity;
+        const auto method =
+            capacity == 0 ? std::string("no capacity") : std::format("capacity {}", capacity);
+        rows.push_back(run_cp_sat(method, inst_data, build_options, time_limit));
+    }
+    return rows;
+}
+
+// the machine circuits against the rank formulation of the machine sequences
+std::vector<BenchRow> bench_sequencing(const InstData& inst_data, int time_limit)
+{
+    std::vector<BenchRow> rows;
+    for (const auto formulation : {SequencingFormulation::Circuit, SequencingFormulation::Rank}) {
+        BuildOptions build_options;
+        build_options.sequencing_formulation = formulation;
+        const auto method =
+            formulation == SequencingFormulation::Circuit ? "machine circuit" : "machine rank";
+        rows.push_back(run_cp_sat(method, inst_data, build_options, time_limit));
+    }
+    return rows;
+}
+
+// the sharing limits halved so they bind, then the run count on the machines against the campaign
+// count along the reticle circuits with requalifications, greedy and CP-SAT under each rule
+std::vector<BenchRow> bench_reticle_usage(const InstData& inst_data, int time_limit)
+{
+    auto binding_data = inst_data;
+    for (auto& [reticle_id, limit] : binding_data.reticle_sharing_limits) {
+        limit = std::max(1, limit / 2);
+    }
+    std::cout << "Binding reticles: " << find_binding_reticles(binding_data).size() << " of "
+              << binding_data.reticle_sharing_limits.size() << std::endl;
+
+    std::vector<BenchRow> rows;
+    for (const auto rule : {ReticleUsageRule::MachineRun, ReticleUsageRule::Campaign}) {
+        binding_data.reticle_usage_rule = rule;
+        const std::string name = rule == ReticleUsageRule::MachineRun ? "machine run" : "campaign";
+
+        const auto start_time = std::chrono::steady_clock::now();
+        const auto schedule   = greedy_schedule(binding_data);
+        rows.push_back({name + " greedy",
+                        schedule_objective(schedule, binding_data),
+                        seconds_since(start_time)});
+        rows.push_back(run_cp_sat(name + " cp-sat", binding_data, BuildOptions(), time_limit));
+    }
+    return rows;
+}
+
+// the jobs of the instance copied onto its first machine until num_jobs, with their reticles,
+// processing times, release and due times and without sharing limit, to compare the formulations
+// on a long sequence
+InstData make_large_machine_instance(const InstData& inst_data, int num_jobs)
+{
+    std::map<JobID, TimeStamp> job_processing_times;   // on the first candidate machine
+    for (const auto& [task_id, processing_time] : inst_data.processing_times) {
+        job_processing_times.try_emplace(task_id.first, processing_time);
+    }
+
+    InstData large_data = inst_data;
+    large_data.job_ded_machines.clear();
+    large_data.job_release_times.clear();
+    large_data.job_due_times.clear();
+    large_data.job_reticle_pairs.clear();
+    large_data.processing_times.clear();
+    large_data.job_predecessors.clear();
+    if (job_processing_times.empty()) {
+        return large_data;
+    }
+
+    const auto machine_id = inst_data.changeovers.machines().front();
+    auto       source     = job_processing_times.begin();
+    for (JobID job_id = 0; job_id < static_cast<JobID>(num_jobs); ++job_id, ++source) {
+        if (source == job_processing_times.end()) {
+            source = job_processing_times.begin();
+        }
+        const auto from                                   = source->first;
+        large_data.job_release_times[job_id]              = inst_data.job_release_times.at(from);
+        large_data.job_due_times[job_id]                  = inst_data.job_due_times.at(from);
+        large_data.job_reticle_pairs[job_id]              = inst_data.job_reticle_pairs.at(from);
+        large_data.processing_times[{job_id, machine_id}] = source->second;
+    }
+    // the sequences are compared, not the sharing limits
+    for (auto& [reticle_id, limit] : large_data.reticle_sharing_limits) {
+        limit = num_jobs + large_data.reticle_init_usage.at(reticle_id);
+    }
+    build_changeover_table(large_data);
+    return large_data;
+}
+
+// the machine circuits against the rank formulation on one machine with 200 jobs
+std::vector<BenchRow> bench_sequencing_large(const InstData& inst_data, int time_limit)
+{
+    const auto large_data = make_large_machine_instance(inst_data, 200);
+
+    std::vector<BenchRow> rows;
+    for (const auto formulation : {SequencingFormulation::Circuit, SequencingFormulation::Rank}) {
+        BuildOptions build_options;
+        build_options.sequencing_formulation = formulation;
+        const auto method =
+            formulation == SequencingFormulation::Circuit ? "machine circuit" : "machine rank";
+        rows.push_back(run_cp_sat(method, large_data, build_options, time_limit));
+    }
+    return rows;
+}
+
+// time to the first feasible solution, cold and warm started from data/sol.csv
+std::vector<BenchRow> bench_warm_start(const InstData& inst_data, int time_limit)
+{
+    const auto report = compare_warm_start(inst_data, WarmStartOptions(), NUM_THREADS, time_limit);
+    print_warm_start_report(report);
+    return {{"cold first solution", report.cold_first_solution_value,
+             report.cold_first_solution_time},
+            {"warm first solution", report.warm_first_solution_value,
+             report.warm_first_solution_time}};
+}
+
+const std::map<std::string, std::function<std::vector<BenchRow>(const InstData&, int)>>
+    SCENARIOS = {
+        {"decomposition", bench_decomposition},
+        {"hot_lot", bench_hot_lot},
+        {"local_search", bench_local_search},
+        {"reticle_usage", bench_reticle_usage},
+        {"sequencing", bench_sequencing},
+        {"sequencing_large", bench_sequencing_large},
+        {"setup_lookup", bench_setup_lookup},
+        {"transport", bench_transport},
+        {"warm_start", bench_warm_start},
+};
+
+void print_rows(const std::string& scenario, const std::vector<BenchRow>& rows)
+{
+    std::cout << "== " << scenario << std::endl;
+    std::cout << std::left << std::setw(24) << "method" << std::setw(12) << "objective"
+              << "wall time (s)" << std::endl;
+    for (const auto& row : rows) {
+        std::cout << std::left << std::setw(24) << row.method << std::setw(12) << row.objective
+                  << std::fixed << std::setprecision(3) << row.wall_time << std::endl;
+    }
+}
+
+}   // namespace
+
+// usage: litho_bench [scenario|all] [time_limit]
+// compare the methods of a scenario on the instance under data folder
+int main(int argc, char** argv)
+{
+    std::string scenario   = argc > 1 ? argv[1] : "all";
+    int         time_limit = argc > 2 ? std::stoi(argv[2]) : 10;
+
+    if (scenario != "all" and !SCENARIOS.contains(scenario)) {
+        std::cerr << "Unknown scenario: " << scenario << ", one of: all";
+        for (const auto& [name, _] : SCENARIOS) {
+            std::cerr << " " << name;
+        }
+        std::cerr << std::endl;
+        return 1;
+    }
+
+    const auto inst_data = read_inst_data();
+    for (const auto& [name, bench] : SCENARIOS) {
+        if (scenario == "all" or scenario == name) {
+            print_rows(name, bench(inst_data, time_limit));
+        }
+    }
+
+    return 0;
+}
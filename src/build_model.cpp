@@ -1,20 +1,458 @@
 
+#include <sys/resource.h>
+
 #include "ortools/sat/cp_model.h"
 
+#include "alloc_counter.hpp"
 #include "build_model.hpp"
+#include "changeover.hpp"
+#include "heuristic.hpp"
 #include "types.hpp"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <limits>
+#include <numeric>
+#include <set>
 #include <vector>
 
 namespace operations_research {
 namespace sat {
 constexpr bool DEBUG = true;
 
-CpModelBuilder build_model()
+// the start domain holes of a task beyond this number are left to the machine no overlap
+constexpr int MAX_START_DOMAIN_HOLES = 64;
+
+void build_model(CpModelBuilder& cp_model, TaskVars& task_vars, ModelIndex& model_index,
+                 std::vector<IntVar>& obj_exprs, const InstData& inst_data,
+                 const BuildOptions& options)
+{
+    const auto start_time        = std::chrono::steady_clock::now();
+    const auto start_allocations = allocation_count();
+
+    // the pruning of the slow alternatives is a heuristic, it is only applied on request
+    InstData        reduced_data;
+    const InstData* input = &inst_data;
+    if (options.prune_slow_alternatives) {
+        reduced_data = inst_data;
+        prune_slow_alternatives(reduced_data);
+        build_changeover_table(reduced_data);
+        input = &reduced_data;
+    }
+
+    // fit the model in the memory budget, the fixed assignment builds on a reduced instance
+    const auto plan = plan_model_build(*input, options);
+    if (options.reserve_proto) {
+        reserve_model_proto(cp_model, plan.estimate);
+    }
+
+    InstData        fixed_data;
+    const InstData* data = input;
+    if (plan.degradation == MemoryDegradation::FixedAssignment) {
+        fixed_data = fix_machine_assignment(*input, plan.schedule);
+        data       = &fixed_data;
+    }
+    print_build_phase("plan", cp_model);
+
+    auto max_horizon = find_max_horizon(*data);
+
+    // vars
+    add_task_transfer_vars(cp_model, task_vars, *data);
+    add_task_setup_vars(cp_model, task_vars, *data);
+    add_task_start_vars(cp_model, task_vars, *data, max_horizon);
+    add_task_end_vars(cp_model, task_vars, *data, max_horizon);
+    add_job_start_vars(cp_model, task_vars, *data, max_horizon);
+    add_job_end_vars(cp_model, task_vars, *data, max_horizon);
+    add_task_presence_vars(cp_model, task_vars, *data);
+    add_task_optional_interval_vars(cp_model, task_vars, *data);
+    add_reticle_sharing_vars(cp_model, task_vars, *data);
+
+    // not used now
+    add_task_position_vars(cp_model, task_vars, *data);
+    print_build_phase("vars", cp_model);
+
+    // constraints
+    add_task_precense_constraints(cp_model, task_vars);
+    add_job_time_constraints(cp_model, task_vars);
+    add_job_release_time_constraints(cp_model, task_vars, *data, model_index);
+    add_job_route_constraints(cp_model, task_vars, *data);
+    add_reticle_max_sharing_constraints(cp_model, task_vars, *data);
+    add_machine_no_overlap_constraints(cp_model, task_vars, *data);
+    add_reticle_no_overlap_constraints(cp_model, task_vars, *data);
+    print_build_phase("task constraints", cp_model);
+
+    switch (options.sequencing_formulation) {
+    case SequencingFormulation::Circuit:
+        add_setup_constraints(cp_model, task_vars, *data, plan.arc_limits);
+        break;
+    case SequencingFormulation::Rank:
+        add_setup_constraints_by_rank(cp_model, task_vars, *data, max_horizon);
+        break;
+    }
+    print_build_phase("machine sequences", cp_model);
+
+    switch (options.transfer_formulation) {
+    case TransferFormulation::Circuit:
+        add_transfer_constraints(cp_model, task_vars, *data, plan.arc_limits);
+        break;
+    case TransferFormulation::IdCircuit:
+        add_transfer_constraints_by_id(cp_model, task_vars, *data, plan.arc_limits);
+        break;
+    }
+    if (options.transport_capacity > 0) {
+        add_transport_capacity_constraints(cp_model, task_vars, options.transport_capacity);
+    }
+    print_build_phase("reticle circuits", cp_model);
+
+    // obj
+    obj_exprs.clear();
+    add_obj_minimize_makespan(cp_model, task_vars, obj_exprs, max_horizon);
+    // add_obj_minimize_transfer_time(cp_model, task_vars, obj_exprs, max_horizon);
+    // add_obj_minimize_setup_time(cp_model, task_vars, obj_exprs, max_horizon);
+    add_obj_minimize_tardiness(cp_model, task_vars, obj_exprs, *data, model_index);
+
+    cp_model.Minimize(LinearExpr::Sum(obj_exprs));
+
+    if (options.fixed_search_order) {
+        add_search_strategy(cp_model, task_vars);
+    }
+
+    // the arcs of the dispatch schedule are kept by the pruning, it is a feasible start
+    if (!plan.schedule.empty()) {
+        add_solution_hint(cp_model, task_vars, plan.schedule);
+    }
+    print_build_phase("objective", cp_model);
+
+    if (DEBUG) {
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+        std::cout << "Build time: " << elapsed.count() << " s";
+        if (ALLOCATIONS_COUNTED) {
+            std::cout << ", allocations: " << allocation_count() - start_allocations;
+        }
+        std::cout << (options.reserve_proto ? ", reserved proto" : "") << std::endl;
+    }
+}
+
+namespace {
+
+// rough sizes of the model parts, including the proto, the TaskVars map nodes and the names
+constexpr std::size_t BYTES_PER_TASK     = 2048;   // ~12 vars, ~15 constraints, 2 intervals
+constexpr std::size_t BYTES_PER_ARC      = 640;    // literal, ~4 enforced constraints, arc
+constexpr std::size_t BYTES_PER_ARC_NAME = 64;     // name of the adjacency literal
+constexpr std::size_t BYTES_PER_ARC_NODE = 96;     // recorded literal in a TaskVars map
+constexpr std::size_t BYTES_PER_RANK_TASK  = 1536;   // ~7 vars, ~12 constraints of the rank
+constexpr std::size_t BYTES_PER_RANK_ENTRY = 32;     // element entry, mostly a constant
+constexpr int         MIN_NEIGHBORS        = 4;      // smallest arc window of the pruning
+
+// proto entries of the model parts, as counted in the sizes above
+constexpr int64_t VARIABLES_PER_TASK        = 12;
+constexpr int64_t CONSTRAINTS_PER_TASK      = 15;
+constexpr int64_t CONSTRAINTS_PER_ARC       = 4;   // the arc literal is one variable
+constexpr int64_t RANK_VARIABLES_PER_TASK   = 7;
+constexpr int64_t RANK_CONSTRAINTS_PER_TASK = 12;
+constexpr int64_t RANK_ENTRIES_PER_TASK     = 5;   // elements over the n tasks of the machine
+
+// arcs of a circuit over n nodes when each node is linked to the nodes within max_neighbors ranks
+int64_t count_circuit_arcs(int64_t n, int64_t max_neighbors)
+{
+    if (max_neighbors == 0 or max_neighbors >= n - 1) {
+        return n * (n - 1);
+    }
+    // node i has min(i, k) + min(n - 1 - i, k) neighbors
+    const auto k = max_neighbors;
+    return 2 * (k * (k + 1) / 2 + (n - 1 - k) * k);
+}
+
+// largest arc window that fits in the budget, 0 if even MIN_NEIGHBORS does not
+int find_max_neighbors(const InstData& inst_data, ArcLimits arc_limits,
+                       SequencingFormulation formulation, std::size_t budget)
+{
+    int low = MIN_NEIGHBORS, high = inst_data.processing_times.size();
+    arc_limits.max_neighbors = low;
+    if (estimate_model_size(inst_data, arc_limits, formulation).bytes > budget) {
+        return 0;
+    }
+    while (low < high) {
+        const int middle         = low + (high - low + 1) / 2;
+        arc_limits.max_neighbors = middle;
+        if (estimate_model_size(inst_data, arc_limits, formulation).bytes <= budget) {
+            low = middle;
+        }
+        else {
+            high = middle - 1;
+        }
+    }
+    return low;
+}
+
+// consecutive tasks of the schedule on each machine and on each reticle
+std::set<std::pair<TaskID, TaskID>> find_schedule_arcs(const Schedule& schedule)
+{
+    std::set<std::pair<TaskID, TaskID>> arcs;
+
+    Schedule sorted = schedule;
+    for (const bool by_reticle : {false, true}) {
+        std::sort(sorted.begin(), sorted.end(), [&](const auto& task1, const auto& task2) {
+            const auto resource1 = by_reticle ? task1.reticle_id : task1.machine_id;
+            const auto resource2 = by_reticle ? task2.reticle_id : task2.machine_id;
+            return std::make_pair(resource1, task1.start) < std::make_pair(resource2, task2.start);
+        });
+        for (size_t i = 1; i < sorted.size(); ++i) {
+            const auto& task1 = sorted[i - 1];
+            const auto& task2 = sorted[i];
+            if ((by_reticle ? task1.reticle_id == task2.reticle_id
+                            : task1.machine_id == task2.machine_id)) {
+                arcs.insert({{task1.job_id, task1.machine_id}, {task2.job_id, task2.machine_id}});
+            }
+        }
+    }
+
+    return arcs;
+}
+
+// rank of each task in the (due time, release time, job) order
+std::vector<int> find_due_time_ranks(const std::vector<TaskID>& task_ids, const InstData& inst_data)
+{
+    std::vector<int> order(task_ids.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](int i, int j) {
+        const auto [job1, machine1] = task_ids[i];
+        const auto [job2, machine2] = task_ids[j];
+        return std::make_tuple(inst_data.job_due_times.at(job1),
+                               inst_data.job_release_times.at(job1),
+                               task_ids[i]) < std::make_tuple(inst_data.job_due_times.at(job2),
+                                                              inst_data.job_release_times.at(job2),
+                                                              task_ids[j]);
+    });
+
+    std::vector<int> ranks(task_ids.size());
+    for (size_t rank = 0; rank < order.size(); ++rank) {
+        ranks[order[rank]] = rank;
+    }
+    return ranks;
+}
+
+bool keep_arc(const ArcLimits& arc_limits, TaskID task1, TaskID task2, int rank1, int rank2)
+{
+    return arc_limits.max_neighbors == 0 or std::abs(rank1 - rank2) <= arc_limits.max_neighbors or
+           arc_limits.required_arcs.contains({task1, task2});
+}
+
+}   // namespace
+
+ModelSizeEstimate estimate_model_size(const InstData& inst_data, const ArcLimits& arc_limits,
+                                      SequencingFormulation formulation)
+{
+    std::map<MachineID, int64_t> machine_task_counts;
+    std::map<ReticleID, int64_t> reticle_task_counts;
+    for (const auto& [task_id, _] : inst_data.processing_times) {
+        const auto [job_id, machine_id] = task_id;
+        machine_task_counts[machine_id]++;
+        reticle_task_counts[inst_data.job_reticle_pairs.at(job_id)]++;
+    }
+
+    ModelSizeEstimate estimate;
+    estimate.num_tasks = inst_data.processing_times.size();
+    // the machine sequences are circuits, or ranks with elements over the tasks of the machine
+    for (const auto& [_, count] : machine_task_counts) {
+        switch (formulation) {
+        case SequencingFormulation::Circuit:
+            estimate.num_arcs += count_circuit_arcs(count, arc_limits.max_neighbors);
+            break;
+        case SequencingFormulation::Rank:
+            estimate.num_rank_entries += RANK_ENTRIES_PER_TASK * count * count;
+            break;
+        }
+    }
+    for (const auto& [_, count] : reticle_task_counts) {
+        estimate.num_arcs += count_circuit_arcs(count, arc_limits.max_neighbors);
+    }
+    estimate.num_arcs += arc_limits.required_arcs.size();
+
+    const auto bytes_per_arc = BYTES_PER_ARC + (arc_limits.with_names ? BYTES_PER_ARC_NAME : 0) +
+                               (arc_limits.record_literals ? BYTES_PER_ARC_NODE : 0);
+    estimate.bytes = estimate.num_tasks * BYTES_PER_TASK + estimate.num_arcs * bytes_per_arc;
+    if (formulation == SequencingFormulation::Rank) {
+        estimate.bytes += estimate.num_tasks * BYTES_PER_RANK_TASK +
+                          estimate.num_rank_entries * BYTES_PER_RANK_ENTRY;
+    }
+    // the task setup matrix is held as long as the model
+    estimate.bytes += inst_data.changeovers.task_setup_bytes();
+
+    return estimate;
+}
+
+void reserve_model_proto(CpModelBuilder& cp_model, const ModelSizeEstimate& estimate)
+{
+    auto num_variables   = estimate.num_tasks * VARIABLES_PER_TASK + estimate.num_arcs;
+    auto num_constraints =
+        estimate.num_tasks * CONSTRAINTS_PER_TASK + estimate.num_arcs * CONSTRAINTS_PER_ARC;
+    if (estimate.num_rank_entries > 0) {
+        num_variables += estimate.num_tasks * RANK_VARIABLES_PER_TASK;
+        num_constraints += estimate.num_tasks * RANK_CONSTRAINTS_PER_TASK;
+    }
+
+    // the protobuf repeated fields have an int size
+    constexpr int64_t max_size = std::numeric_limits<int>::max();
+    auto*             proto    = cp_model.MutableProto();
+    proto->mutable_variables()->Reserve(static_cast<int>(std::min(num_variables, max_size)));
+    proto->mutable_constraints()->Reserve(static_cast<int>(std::min(num_constraints, max_size)));
+}
+
+BuildPlan plan_model_build(const InstData& inst_data, const BuildOptions& options)
+{
+    const auto formulation = options.sequencing_formulation;
+
+    BuildPlan plan;
+    plan.arc_limits.record_literals = options.record_arc_literals;
+    plan.estimate                   = estimate_model_size(inst_data, plan.arc_limits, formulation);
+
+    const auto budget = options.memory_budget;
+    auto       fits   = [&]() { return budget == 0 or plan.estimate.bytes <= budget; };
+
+    // 1. no names on the adjacency literals
+    if (!fits()) {
+        plan.degradation           = MemoryDegradation::NoNames;
+        plan.arc_limits.with_names = false;
+        plan.estimate              = estimate_model_size(inst_data, plan.arc_limits, formulation);
+    }
+
+    // 2. arcs only between the tasks close in due time order, and those of the dispatch schedule.
+    // the model does not fit, so the schedule comes from the one pass dispatch rule
+    if (!fits()) {
+        plan.schedule                 = dispatch_schedule(inst_data);
+        plan.arc_limits.required_arcs = find_schedule_arcs(plan.schedule);
+        plan.arc_limits.max_neighbors =
+            find_max_neighbors(inst_data, plan.arc_limits, formulation, budget);
+        plan.degradation              = MemoryDegradation::PrunedArcs;
+        if (plan.arc_limits.max_neighbors > 0) {
+            plan.estimate = estimate_model_size(inst_data, plan.arc_limits, formulation);
+        }
+    }
+
+    // 3. the jobs fixed on the machines of the dispatch schedule, pruned again if still needed
+    if (plan.degradation == MemoryDegradation::PrunedArcs and plan.arc_limits.max_neighbors == 0) {
+        const auto fixed_data = fix_machine_assignment(inst_data, plan.schedule);
+        plan.degradation      = MemoryDegradation::FixedAssignment;
+        plan.estimate         = estimate_model_size(fixed_data, plan.arc_limits, formulation);
+        if (!fits()) {
+            const auto max_neighbors =
+                find_max_neighbors(fixed_data, plan.arc_limits, formulation, budget);
+            plan.arc_limits.max_neighbors = std::max(MIN_NEIGHBORS, max_neighbors);
+            plan.estimate = estimate_model_size(fixed_data, plan.arc_limits, formulation);
+        }
+    }
+
+    if (DEBUG) {
+        constexpr const char* names[] = {"none", "no names", "pruned arcs", "fixed assignment"};
+        std::cout << "Model size estimate: " << plan.estimate.num_tasks << " tasks, "
+                  << plan.estimate.num_arcs << " arcs, " << plan.estimate.num_rank_entries
+                  << " rank entries, " << (plan.estimate.bytes >> 20)
+                  << " MB, degradation: " << names[static_cast<int>(plan.degradation)];
+        if (plan.arc_limits.max_neighbors > 0) {
+            std::cout << ", max neighbors: " << plan.arc_limits.max_neighbors;
+        }
+        std::cout << std::endl;
+        if (!fits()) {
+            std::cout << "Warning: the model does not fit in the memory budget of "
+                      << (budget >> 20) << " MB" << std::endl;
+        }
+    }
+
+    return plan;
+}
+
+InstData fix_machine_assignment(const InstData& inst_data, const Schedule& schedule)
 {
-    CpModelBuilder cp_model;
+    std::map<JobID, MachineID> job_machines;
+    for (const auto& task : schedule) {
+        job_machines[task.job_id] = task.machine_id;
+    }
+
+    // the jobs missing from the schedule keep all their machines
+    InstData fixed_data = inst_data;
+    fixed_data.processing_times.clear();
+    for (const auto& [task_id, duration] : inst_data.processing_times) {
+        const auto [job_id, machine_id] = task_id;
+        const auto it                   = job_machines.find(job_id);
+        if (it == job_machines.end() or it->second == machine_id) {
+            fixed_data.processing_times[task_id] = duration;
+        }
+    }
+    build_changeover_table(fixed_data);
 
-    return cp_model;
+    return fixed_data;
+}
+
+std::size_t peak_rss_bytes()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<std::size_t>(usage.ru_maxrss) * 1024;   // ru_maxrss is in KB on Linux
+}
+
+void print_build_phase(const std::string& phase, const CpModelBuilder& cp_model)
+{
+    std::cout << "Build phase: " << phase << ", variables: " << cp_model.Proto().variables_size()
+              << ", constraints: " << cp_model.Proto().constraints_size()
+              << ", peak RSS: " << (peak_rss_bytes() >> 20) << " MB";
+    if (ALLOCATIONS_COUNTED) {
+        std::cout << ", allocations: " << allocation_count();
+    }
+    std::cout << std::endl;
+}
+
+void add_solution_hint(CpModelBuilder& cp_model, const TaskVars& task_vars,
+                       const Schedule& schedule)
+{
+    cp_model.ClearHints();
+
+    std::map<JobID, MachineID> job_machines;
+    for (const auto& task : schedule) {
+        const TaskID task_id = {task.job_id, task.machine_id};
+        if (task_vars.task_presence_vars.find(task_id) == task_vars.task_presence_vars.end()) {
+            // the job is not allowed on this machine in the current model
+            continue;
+        }
+        job_machines[task.job_id] = task.machine_id;
+
+        cp_model.AddHint(task_vars.task_transfer_vars.at(task_id), task.transfer);
+        cp_model.AddHint(task_vars.task_setup_vars.at(task_id), task.setup);
+        cp_model.AddHint(task_vars.task_start_vars.at(task_id), task.start);
+        cp_model.AddHint(task_vars.task_end_vars.at(task_id), task.end);
+        cp_model.AddHint(task_vars.reticle_sharing_vars.at(task_id), task.reticle_usage);
+        cp_model.AddHint(task_vars.task_position_vars.at(task_id), task.position);
+        cp_model.AddHint(task_vars.job_start_vars.at(task.job_id), task.start);
+        cp_model.AddHint(task_vars.job_end_vars.at(task.job_id), task.end);
+    }
+
+    // the presence of all the alternatives of the hinted jobs
+    for (const auto& [task_id, presence_var] : task_vars.task_presence_vars) {
+        const auto [job_id, machine_id] = task_id;
+        if (job_machines.find(job_id) == job_machines.end()) {
+            continue;
+        }
+        cp_model.AddHint(presence_var, job_machines.at(job_id) == machine_id);
+    }
+
+    // the recorded adjacency literals between hinted tasks: true for the consecutive tasks on
+    // each machine and on each reticle
+    if (task_vars.machine_arc_literals.empty() and task_vars.reticle_arc_literals.empty()) {
+        return;
+    }
+    const auto consecutive_arcs = find_schedule_arcs(schedule);
+    auto       hinted           = [&](TaskID task_id) {
+        const auto it = job_machines.find(task_id.first);
+        return it != job_machines.end() and it->second == task_id.second;
+    };
+    for (const auto* arc_literals :
+         {&task_vars.machine_arc_literals, &task_vars.reticle_arc_literals}) {
+        for (const auto& [arc, literal] : *arc_literals) {
+            if (hinted(arc.first) and hinted(arc.second)) {
+                cp_model.AddHint(literal, consecutive_arcs.contains(arc));
+            }
+        }
+    }
 }
 
 void filter_tasks(const std::map<TaskID, TimeStamp>& all_task_ptime_map, InstData& inst_data)
@@ -48,6 +486,111 @@ void filter_tasks(const std::map<TaskID, TimeStamp>& all_task_ptime_map, InstDat
     inst_data.processing_times.swap(new_task_ptime_map);
 }
 
+int prune_slow_alternatives(InstData& inst_data)
+{
+    // pairs missing in the transfer map cost 0, as in the changeover table
+    auto setup_time = [&](MachineID machine_id, ReticleID from, ReticleID to) {
+        return inst_data.setup_times.get_setup_time(machine_id, from, to);
+    };
+    auto transfer_time = [&](ReticleID reticle_id, MachineID machine_id) -> TimeDuration {
+        const auto init = inst_data.reticle_init_positions.find(reticle_id);
+        if (init == inst_data.reticle_init_positions.end()) {
+            return 0;
+        }
+        const auto it = inst_data.transfer_times.find(
+            {static_cast<int>(init->second), static_cast<int>(machine_id)});
+        return it == inst_data.transfer_times.end() ? 0 : it->second;
+    };
+
+    auto downtimes = [&](MachineID machine_id) -> const std::vector<TimeWindow>* {
+        const auto it = inst_data.machine_downtimes.find(machine_id);
+        return it == inst_data.machine_downtimes.end() or it->second.empty() ? nullptr
+                                                                             : &it->second;
+    };
+
+    std::map<MachineID, std::set<ReticleID>> machine_reticles;
+    std::map<JobID, std::vector<MachineID>>  job_machines;
+    for (const auto& [task_id, _] : inst_data.processing_times) {
+        const auto [job_id, machine_id] = task_id;
+        machine_reticles[machine_id].insert(inst_data.job_reticle_pairs.at(job_id));
+        job_machines[job_id].push_back(machine_id);
+    }
+
+    // (job, other) is slower than (job, machine) when it is strictly longer, its changeovers
+    // from and to every reticle of the two machines and its first reticle transfer are no
+    // shorter, and the machine has no downtime or the same as the other. the strict processing
+    // time keeps both tasks on identical machines
+    auto is_faster = [&](JobID job_id, MachineID machine_id, MachineID other_id) {
+        if (inst_data.processing_times.at({job_id, machine_id}) >=
+            inst_data.processing_times.at({job_id, other_id})) {
+            return false;
+        }
+        if (downtimes(machine_id) != nullptr and downtimes(machine_id) != downtimes(other_id) and
+            *downtimes(machine_id) != *downtimes(other_id)) {
+            return false;
+        }
+        const auto reticle_id = inst_data.job_reticle_pairs.at(job_id);
+        if (transfer_time(reticle_id, machine_id) > transfer_time(reticle_id, other_id)) {
+            return false;
+        }
+        for (const auto* reticles : {&machine_reticles[machine_id], &machine_reticles[other_id]}) {
+            for (const auto other_reticle : *reticles) {
+                if (setup_time(machine_id, other_reticle, reticle_id) >
+                        setup_time(other_id, other_reticle, reticle_id) or
+                    setup_time(machine_id, reticle_id, other_reticle) >
+                        setup_time(other_id, reticle_id, other_reticle)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+
+    std::vector<TaskID> slow_tasks;
+    for (const auto& [job_id, machine_ids] : job_machines) {
+        for (const auto other_id : machine_ids) {
+            if (std::any_of(machine_ids.begin(), machine_ids.end(), [&](MachineID machine_id) {
+                    return is_faster(job_id, machine_id, other_id);
+                })) {
+                slow_tasks.push_back({job_id, other_id});
+            }
+        }
+    }
+    for (const auto& task_id : slow_tasks) {
+        inst_data.processing_times.erase(task_id);
+    }
+
+    // each task has a presence literal and an optional interval, and is a node of its machine
+    // circuit and of its reticle circuit
+    if (DEBUG) {
+        const auto num_tasks = slow_tasks.size();
+        std::cout << "Slow alternatives pruned: " << num_tasks << " (" << num_tasks
+                  << " presence literals, " << num_tasks << " intervals, " << 2 * num_tasks
+                  << " circuit nodes)" << std::endl;
+    }
+    return static_cast<int>(slow_tasks.size());
+}
+
+std::set<ReticleID> find_binding_reticles(const InstData& inst_data)
+{
+    std::set<JobID>          jobs;
+    std::map<ReticleID, int> reticle_jobs;
+    for (const auto& [task_id, _] : inst_data.processing_times) {
+        if (jobs.insert(task_id.first).second) {
+            reticle_jobs[inst_data.job_reticle_pairs.at(task_id.first)]++;
+        }
+    }
+
+    std::set<ReticleID> binding_reticles;
+    for (const auto& [reticle_id, num_jobs] : reticle_jobs) {
+        if (inst_data.reticle_init_usage.at(reticle_id) + num_jobs >
+            inst_data.reticle_sharing_limits.at(reticle_id)) {
+            binding_reticles.insert(reticle_id);
+        }
+    }
+    return binding_reticles;
+}
+
 TimeStamp find_max_horizon(const InstData& inst_data)
 {
     // TODO: maybe need refine the max horizon calculation
@@ -56,6 +599,25 @@ TimeStamp find_max_horizon(const InstData& inst_data)
         max_horizon += duration;
     }
 
+    // all the tasks can be processed after the last downtime
+    TimeStamp last_downtime_end = 0;
+    for (const auto& [_, windows] : inst_data.machine_downtimes) {
+        if (!windows.empty()) {
+            last_downtime_end = std::max(last_downtime_end, windows.back().second);
+        }
+    }
+    max_horizon += last_downtime_end;
+
+    // a requalification before each use of a reticle, at most
+    if (inst_data.reticle_usage_rule == ReticleUsageRule::Campaign) {
+        max_horizon += REQUALIFICATION_TIME * inst_data.job_reticle_pairs.size();
+    }
+
+    // the queue times between the layers of the lots
+    for (const auto& [_, step] : inst_data.job_predecessors) {
+        max_horizon += step.min_queue_time;
+    }
+
     // print the max horizon
     if (DEBUG) {
         std::cout << "Max Horizon: " << max_horizon << std::endl;
@@ -113,31 +675,28 @@ std::map<TaskID, TimeStamp> find_task_max_setup_time(const InstData& inst_data)
         }
     }
 
-    // from the machine_reticles_map and task_stime_map , find the max setup
-    // time for each task
-    for (const auto& [task_id, _] : inst_data.processing_times) {
-        const auto [job_id, machine_id] = task_id;
-        const auto reticle_id           = inst_data.job_reticle_pairs.at(job_id);
-        for (const auto& [setup_pair, setup_time] : inst_data.setup_times) {
-            const auto [machine_id, reticle_id_1, reticle_id_2] = setup_pair;
-            // only consider the setup time to the same reticle on same machine
-            if (reticle_id_2 != reticle_id) {
-                continue;
-            }
-
-            // only consider the setup time to the reticle that can be processed
-            // on the same machine
-            if (machine_reticles_map[machine_id].find(reticle_id_1) ==
-                machine_reticles_map[machine_id].end()) {
-                continue;
+    // the max setup time to each reticle from the reticles that can be processed on the same
+    // machine, over all the machines with setups
+    const auto&                    setup_times = inst_data.setup_times;
+    std::map<ReticleID, TimeStamp> max_setup_to_reticle;
+    for (const auto& [machine_id, reticle_ids] : machine_reticles_map) {
+        if (setup_times.get_family(machine_id) < 0) {
+            continue;
+        }
+        for (ReticleID reticle_id = 0; reticle_id < setup_times.num_reticles(); ++reticle_id) {
+            auto& max_setup_time = max_setup_to_reticle[reticle_id];
+            for (const auto from : reticle_ids) {
+                const auto setup_time = setup_times.get_setup_time(machine_id, from, reticle_id);
+                max_setup_time        = std::max<TimeStamp>(max_setup_time, setup_time);
             }
+        }
+    }
 
-            if (max_setup_time_map.find(task_id) == max_setup_time_map.end()) {
-                max_setup_time_map[task_id] = setup_time;
-            }
-            else {
-                max_setup_time_map[task_id] = std::max(max_setup_time_map[task_id], setup_time);
-            }
+    for (const auto& [task_id, _] : inst_data.processing_times) {
+        const auto reticle_id = inst_data.job_reticle_pairs.at(task_id.first);
+        const auto it         = max_setup_to_reticle.find(reticle_id);
+        if (it != max_setup_to_reticle.end()) {
+            max_setup_time_map[task_id] = it->second;
         }
     }
 
@@ -203,14 +762,48 @@ void add_task_setup_vars(CpModelBuilder& cp_model, TaskVars& task_vars, const In
     }
 }
 
+Domain find_task_start_domain(const InstData& inst_data, TaskID task_id, TimeStamp horizon)
+{
+    const auto [job_id, machine_id] = task_id;
+    const auto it                   = inst_data.machine_downtimes.find(machine_id);
+    if (it == inst_data.machine_downtimes.end()) {
+        return {0, horizon};
+    }
+
+    // the task overlaps the window [start, end) when it starts in [start - duration + 1, end - 1],
+    // the holes of the close windows merge when the task does not fit between them
+    const int64_t        duration = inst_data.processing_times.at(task_id);
+    std::vector<int64_t> flat_intervals;
+    int64_t              allowed_start = 0;
+    int                  num_holes     = 0;
+    for (const auto& [start, end] : it->second) {
+        const auto blocked_start = std::max<int64_t>(0, start - duration + 1);
+        if (blocked_start > horizon or num_holes == MAX_START_DOMAIN_HOLES) {
+            break;
+        }
+        if (blocked_start > allowed_start) {
+            flat_intervals.push_back(allowed_start);
+            flat_intervals.push_back(blocked_start - 1);
+            num_holes++;
+        }
+        allowed_start = std::max<int64_t>(allowed_start, end);
+    }
+    if (allowed_start <= horizon) {
+        flat_intervals.push_back(allowed_start);
+        flat_intervals.push_back(horizon);
+    }
+
+    return Domain::FromFlatIntervals(flat_intervals);
+}
+
 void add_task_start_vars(CpModelBuilder& cp_model, TaskVars& task_vars, const InstData& inst_data,
                          TimeStamp horizon)
 {
     task_vars.task_start_vars.clear();
-    Domain domain = {0, horizon};
 
     for (const auto& [task_id, duration] : inst_data.processing_times) {
         const auto [job_id, machine_id] = task_id;
+        const auto domain               = find_task_start_domain(inst_data, task_id, horizon);
 
         std::string suffix = std::format("_{}_{}", job_id, machine_id);
         task_vars.task_start_vars[task_id] =
@@ -227,10 +820,11 @@ void add_task_end_vars(CpModelBuilder& cp_model, TaskVars& task_vars, const Inst
                        TimeStamp horizon)
 {
     task_vars.task_end_vars.clear();
-    Domain domain = {0, horizon};
 
     for (const auto& [task_id, duration] : inst_data.processing_times) {
         const auto [job_id, machine_id] = task_id;
+        const auto domain =
+            find_task_start_domain(inst_data, task_id, horizon).AdditionWith(Domain(duration));
 
         std::string suffix = std::format("_{}_{}", job_id, machine_id);
         task_vars.task_end_vars[task_id] =
@@ -243,6 +837,52 @@ void add_task_end_vars(CpModelBuilder& cp_model, TaskVars& task_vars, const Inst
     }
 }
 
+void add_job_start_vars(CpModelBuilder& cp_model, TaskVars& task_vars, const InstData& inst_data,
+                        TimeStamp horizon)
+{
+    task_vars.job_start_vars.clear();
+    Domain domain = {0, horizon};
+
+    for (const auto& [task_id, duration] : inst_data.processing_times) {
+        const auto [job_id, machine_id] = task_id;
+        // one start var per job, shared by all the candidate tasks of the job
+        if (task_vars.job_start_vars.find(job_id) != task_vars.job_start_vars.end()) {
+            continue;
+        }
+
+        task_vars.job_start_vars[job_id] =
+            cp_model.NewIntVar(domain).WithName(std::format("job_start_{}", job_id));
+
+        if (DEBUG) {
+            std::cout << "Job: " << job_id
+                      << ", Job Start Time Var: " << task_vars.job_start_vars[job_id] << std::endl;
+        }
+    }
+}
+
+void add_job_end_vars(CpModelBuilder& cp_model, TaskVars& task_vars, const InstData& inst_data,
+                      TimeStamp horizon)
+{
+    task_vars.job_end_vars.clear();
+    Domain domain = {0, horizon};
+
+    for (const auto& [task_id, duration] : inst_data.processing_times) {
+        const auto [job_id, machine_id] = task_id;
+        // one end var per job, shared by all the candidate tasks of the job
+        if (task_vars.job_end_vars.find(job_id) != task_vars.job_end_vars.end()) {
+            continue;
+        }
+
+        task_vars.job_end_vars[job_id] =
+            cp_model.NewIntVar(domain).WithName(std::format("job_end_{}", job_id));
+
+        if (DEBUG) {
+            std::cout << "Job: " << job_id
+                      << ", Job End Time Var: " << task_vars.job_end_vars[job_id] << std::endl;
+        }
+    }
+}
+
 void add_task_presence_vars(CpModelBuilder& cp_model, TaskVars& task_vars,
                             const InstData& inst_data)
 {
@@ -307,6 +947,21 @@ void add_reticle_sharing_vars(CpModelBuilder& cp_model, TaskVars& task_vars,
                       << ", Sharing Var: " << task_vars.reticle_sharing_vars[task_id] << std::endl;
         }
     }
+
+    // the requalification is only modeled for the reticles that can reach their limit, the
+    // others count their uses along the reticle circuit
+    task_vars.reticle_limit_vars.clear();
+    if (inst_data.reticle_usage_rule != ReticleUsageRule::Campaign) {
+        return;
+    }
+    const auto binding_reticles = find_binding_reticles(inst_data);
+    for (const auto& [task_id, _] : inst_data.processing_times) {
+        const auto [job_id, machine_id] = task_id;
+        if (binding_reticles.contains(inst_data.job_reticle_pairs.at(job_id))) {
+            task_vars.reticle_limit_vars[task_id] = cp_model.NewBoolVar().WithName(
+                std::format("sharing_limit_{}_{}", job_id, machine_id));
+        }
+    }
 }
 
 void add_task_position_vars(CpModelBuilder& cp_model, TaskVars& task_vars,
@@ -341,6 +996,20 @@ void add_task_position_vars(CpModelBuilder& cp_model, TaskVars& task_vars,
     }
 }
 
+void add_search_strategy(CpModelBuilder& cp_model, const TaskVars& task_vars)
+{
+    // a stable variable order: the job start times in job id order, earliest start first.
+    // it is followed only with search_branching FIXED_SEARCH (set_deterministic_mode)
+    std::vector<IntVar> start_vars;
+    for (const auto& [job_id, start_var] : task_vars.job_start_vars) {
+        start_vars.push_back(start_var);
+    }
+
+    cp_model.AddDecisionStrategy(start_vars,
+                                 DecisionStrategyProto::CHOOSE_FIRST,
+                                 DecisionStrategyProto::SELECT_MIN_VALUE);
+}
+
 void add_task_precense_constraints(CpModelBuilder& cp_model, const TaskVars& task_vars)
 {
     // for each job, at exactly one task is presence
@@ -364,24 +1033,58 @@ void add_task_precense_constraints(CpModelBuilder& cp_model, const TaskVars& tas
     }
 }
 
-void add_job_release_time_constraints(CpModelBuilder& cp_model, const TaskVars& task_vars,
-                                      const InstData& inst_data)
+void add_job_time_constraints(CpModelBuilder& cp_model, const TaskVars& task_vars)
 {
-    // add release time constraints for each job
-    for (const auto& [task_id, start_var] : task_vars.task_start_vars) {
+    // the job start / end time is the start / end time of its present task.
+    // the absent tasks are left free, so they never appear in the objectives.
+    for (const auto& [task_id, presence_var] : task_vars.task_presence_vars) {
         const auto [job_id, machine_id] = task_id;
-        auto release_time               = inst_data.job_release_times.at(job_id);
 
-        if (release_time == 0) {
-            continue;
-        }
+        cp_model
+            .AddEquality(task_vars.job_start_vars.at(job_id), task_vars.task_start_vars.at(task_id))
+            .OnlyEnforceIf(presence_var);
+        cp_model.AddEquality(task_vars.job_end_vars.at(job_id), task_vars.task_end_vars.at(task_id))
+            .OnlyEnforceIf(presence_var);
+    }
+}
+
+void add_job_release_time_constraints(CpModelBuilder& cp_model, const TaskVars& task_vars,
+                                      const InstData& inst_data, ModelIndex& model_index)
+{
+    model_index.job_release_constraints.clear();
 
+    // add release time constraints for each job, also for release time 0, so that the release
+    // time can be patched later in the proto
+    for (const auto& [job_id, start_var] : task_vars.job_start_vars) {
+        auto release_time = inst_data.job_release_times.at(job_id);
+
+        model_index.job_release_constraints[job_id] = cp_model.Proto().constraints_size();
         cp_model.AddGreaterOrEqual(start_var, release_time);
 
         if (DEBUG) {
-            std::cout << "Job: " << job_id << ", Machine: " << machine_id
-                      << ", Release Time Constraint: " << start_var << " >= " << release_time
-                      << std::endl;
+            std::cout << "Job: " << job_id << ", Release Time Constraint: " << start_var
+                      << " >= " << release_time << std::endl;
+        }
+    }
+}
+
+void add_job_route_constraints(CpModelBuilder& cp_model, const TaskVars& task_vars,
+                               const InstData& inst_data)
+{
+    // one precedence per layer change of a lot, on the job level vars: it holds whatever machines
+    // the two operations are assigned to
+    for (const auto& [job_id, step] : inst_data.job_predecessors) {
+        const auto start_var = task_vars.job_start_vars.find(job_id);
+        const auto end_var   = task_vars.job_end_vars.find(step.previous_job_id);
+        if (start_var == task_vars.job_start_vars.end() or
+            end_var == task_vars.job_end_vars.end()) {
+            continue;
+        }
+        cp_model.AddGreaterOrEqual(start_var->second, end_var->second + step.min_queue_time);
+
+        if (DEBUG) {
+            std::cout << "Job: " << job_id << ", Route Constraint: " << start_var->second
+                      << " >= " << end_var->second << " + " << step.min_queue_time << std::endl;
         }
     }
 }
@@ -397,6 +1100,13 @@ void add_reticle_max_sharing_constraints(CpModelBuilder& cp_model, const TaskVar
 
         cp_model.AddLessOrEqual(sharing_var, max_sharing);
 
+        // campaign: the limit literal is true exactly when the count is at the limit
+        const auto limit_var = task_vars.reticle_limit_vars.find(task_id);
+        if (limit_var != task_vars.reticle_limit_vars.end()) {
+            cp_model.AddEquality(sharing_var, max_sharing).OnlyEnforceIf(limit_var->second);
+            cp_model.AddLessOrEqual(sharing_var, max_sharing - 1).OnlyEnforceIf(~limit_var->second);
+        }
+
         if (DEBUG) {
             std::cout << "Job: " << job_id << ", Machine: " << machine_id
                       << ", Reticle: " << reticle_id << ", Max Sharing Constraint: " << sharing_var
@@ -406,7 +1116,8 @@ void add_reticle_max_sharing_constraints(CpModelBuilder& cp_model, const TaskVar
 }
 
 
-void add_machine_no_overlap_constraints(CpModelBuilder& cp_model, const TaskVars& task_vars)
+void add_machine_no_overlap_constraints(CpModelBuilder& cp_model, const TaskVars& task_vars,
+                                        const InstData& inst_data)
 {
     // add no overlap constraints for the tasks on the same machine
     std::map<MachineID, std::vector<IntervalVar>> machine_intervals_map;
@@ -420,6 +1131,17 @@ void add_machine_no_overlap_constraints(CpModelBuilder& cp_model, const TaskVars
         }
     }
 
+    // one fixed interval for each downtime window, instead of a disjunction for each task
+    for (const auto& [machine_id, windows] : inst_data.machine_downtimes) {
+        const auto it = machine_intervals_map.find(machine_id);
+        if (it == machine_intervals_map.end()) {
+            continue;
+        }
+        for (const auto& [start, end] : windows) {
+            it->second.push_back(cp_model.NewFixedSizeIntervalVar(start, end - start));
+        }
+    }
+
     for (const auto& [machine_id, interval_vars] : machine_intervals_map) {
         auto name    = std::format("Machine_{}_no_overlap_constraint", machine_id);
         auto overlap = cp_model.AddNoOverlap(interval_vars).WithName(name);
@@ -459,25 +1181,19 @@ void add_reticle_no_overlap_constraints(CpModelBuilder& cp_model, const TaskVars
 }
 
 
-void add_setup_constraints(CpModelBuilder& cp_model, const TaskVars& task_vars,
-                           const InstData& inst_data)
+void add_setup_constraints(CpModelBuilder& cp_model, TaskVars& task_vars,
+                           const InstData& inst_data, const ArcLimits& arc_limits)
 {
-    // for all intervals, add the job to the vector of each machine
-    std::map<MachineID, std::vector<JobID>> machine_local_jobs_map;
-    for (const auto& [task_id, _] : task_vars.task_optional_interval_vars) {
-        const auto [job_id, machine_id] = task_id;
-        if (machine_local_jobs_map.find(machine_id) == machine_local_jobs_map.end()) {
-            machine_local_jobs_map[machine_id] = std::vector<JobID>{job_id};
-        }
-        else {
-            machine_local_jobs_map[machine_id].push_back(job_id);
-        }
-    }
+    task_vars.machine_arc_literals.clear();
+    task_vars.machine_empty_vars.clear();
+
+    // the local jobs of each machine, in the order of the changeover table
+    const auto& changeovers = inst_data.changeovers;
 
     if (DEBUG) {
-        for (const auto& [machine_id, job_ids] : machine_local_jobs_map) {
+        for (const auto machine_id : changeovers.machines()) {
             std::cout << "Machine: " << machine_id << ", Job IDs: ";
-            for (const auto& job_id : job_ids) {
+            for (const auto& job_id : changeovers.machine_jobs(machine_id)) {
                 std::cout << job_id << " ";
             }
             std::cout << std::endl;
@@ -486,9 +1202,29 @@ void add_setup_constraints(CpModelBuilder& cp_model, const TaskVars& task_vars,
 
 
     // for each machine,
-    for (const auto& [machine_id, job_ids] : machine_local_jobs_map) {
+    for (const auto machine_id : changeovers.machines()) {
+        const auto& job_ids = changeovers.machine_jobs(machine_id);
+
+        std::vector<TaskID> task_ids;
+        for (const auto job_id : job_ids) {
+            task_ids.push_back({job_id, machine_id});
+        }
+        const auto ranks = find_due_time_ranks(task_ids, inst_data);
         CircuitConstraint circuit = cp_model.AddCircuitConstraint();
 
+        // the depot loop, exactly when no task of the machine is present (a machine down for the
+        // whole horizon), the circuit has no other arc from the depot then
+        auto empty_lit =
+            cp_model.NewBoolVar().WithName(std::format("machine_empty_{}", machine_id));
+        circuit.AddArc(0, 0, empty_lit);
+        std::vector<BoolVar> empty_or_present = {empty_lit};
+        for (const auto& task_id : task_ids) {
+            cp_model.AddImplication(empty_lit, ~task_vars.task_presence_vars.at(task_id));
+            empty_or_present.push_back(task_vars.task_presence_vars.at(task_id));
+        }
+        cp_model.AddBoolOr(empty_or_present);
+        task_vars.machine_empty_vars[machine_id] = empty_lit;
+
         for (auto id1 = 0; id1 < job_ids.size(); id1++) {
             JobID     job1     = job_ids[id1];
             TaskID    task1    = {job1, machine_id};
@@ -502,8 +1238,8 @@ void add_setup_constraints(CpModelBuilder& cp_model, const TaskVars& task_vars,
             circuit.AddArc(id1 + 1, id1 + 1, ~task_vars.task_presence_vars.at(task1));
             cp_model.AddImplication(start_lit, task_vars.task_presence_vars.at(task1));
             cp_model.AddImplication(last_lit, task_vars.task_presence_vars.at(task1));
-            // cp_model.AddEquality(task_vars.task_position_vars.at(task1), 0)
-            //     .OnlyEnforceIf(start_lit);
+            cp_model.AddEquality(task_vars.task_position_vars.at(task1), 0)
+                .OnlyEnforceIf(start_lit);
 
             // start time of the task >= transfer time + setup time
             cp_model
@@ -541,10 +1277,18 @@ void add_setup_constraints(CpModelBuilder& cp_model, const TaskVars& task_vars,
                 JobID     job2     = job_ids[id2];
                 TaskID    task2    = {job2, machine_id};
                 ReticleID reticle2 = inst_data.job_reticle_pairs.at(job2);
+                if (!keep_arc(arc_limits, task1, task2, ranks[id1], ranks[id2])) {
+                    continue;
+                }
 
-                auto adjacency =
-                    cp_model.NewBoolVar().WithName(std::format("adjacency_{}_{}", job1, job2));
+                auto adjacency = cp_model.NewBoolVar();
+                if (arc_limits.with_names) {
+                    adjacency.WithName(std::format("adjacency_{}_{}", job1, job2));
+                }
                 circuit.AddArc(id1 + 1, id2 + 1, adjacency);
+                if (arc_limits.record_literals) {
+                    task_vars.machine_arc_literals.insert({{task1, task2}, adjacency});
+                }
 
                 // # precent constraints
                 cp_model
@@ -559,9 +1303,14 @@ void add_setup_constraints(CpModelBuilder& cp_model, const TaskVars& task_vars,
                                         task_vars.task_transfer_vars.at(task2),
                                     task_vars.task_start_vars.at(task2))
                     .OnlyEnforceIf(adjacency);
+                cp_model
+                    .AddEquality(task_vars.task_position_vars.at(task2),
+                                 task_vars.task_position_vars.at(task1) + 1)
+                    .OnlyEnforceIf(adjacency);
 
-                // if they share the same reticle
-                if (reticle1 == reticle2) {
+                // if they share the same reticle, the run goes on
+                if (reticle1 == reticle2 and
+                    inst_data.reticle_usage_rule == ReticleUsageRule::MachineRun) {
                     // # reticle sharing constraints
                     cp_model
                         .AddGreaterOrEqual(task_vars.reticle_sharing_vars.at(task2),
@@ -573,7 +1322,7 @@ void add_setup_constraints(CpModelBuilder& cp_model, const TaskVars& task_vars,
                 if (reticle1 != reticle2) {
                     // # setup time constraints
                     TimeDuration setup_time2 =
-                        inst_data.setup_times.at({machine_id, reticle1, reticle2});
+                        changeovers.get_task_setup_time(machine_id, id1, id2);
 
                     cp_model.AddGreaterOrEqual(task_vars.task_setup_vars.at(task2), setup_time2)
                         .OnlyEnforceIf(adjacency);
@@ -583,9 +1332,177 @@ void add_setup_constraints(CpModelBuilder& cp_model, const TaskVars& task_vars,
     }
 }
 
-void add_transfer_constraints(CpModelBuilder& cp_model, const TaskVars& task_vars,
-                              const InstData& inst_data)
+void add_setup_constraints_by_rank(CpModelBuilder& cp_model, TaskVars& task_vars,
+                                   const InstData& inst_data, TimeStamp horizon)
 {
+    task_vars.machine_arc_literals.clear();
+
+    const auto& changeovers = inst_data.changeovers;
+
+    int max_sharing_limit = 1;
+    for (const auto& [reticle_id, limit] : inst_data.reticle_sharing_limits) {
+        max_sharing_limit = std::max(max_sharing_limit, limit);
+    }
+
+    for (const auto machine_id : changeovers.machines()) {
+        const auto& job_ids = changeovers.machine_jobs(machine_id);
+        const int   n       = job_ids.size();
+        if (n == 0) {
+            continue;
+        }
+
+        // the vars of the local tasks, the element constraints pick the predecessor of each task
+        std::vector<IntVar>     positions;
+        std::vector<BoolVar>    presences;
+        std::vector<LinearExpr> starts, ends, setups, transfers, sharings;
+        for (const auto job_id : job_ids) {
+            const TaskID task_id = {job_id, machine_id};
+            positions.push_back(task_vars.task_position_vars.at(task_id));
+            presences.push_back(task_vars.task_presence_vars.at(task_id));
+            starts.push_back(task_vars.task_start_vars.at(task_id));
+            ends.push_back(task_vars.task_end_vars.at(task_id));
+            setups.push_back(task_vars.task_setup_vars.at(task_id));
+            transfers.push_back(task_vars.task_transfer_vars.at(task_id));
+            sharings.push_back(task_vars.reticle_sharing_vars.at(task_id));
+        }
+
+        // the present tasks take the ranks 0 .. num_present - 1, the absent tasks the ranks after
+        // them. the ranks are a permutation, rank_tasks is its inverse
+        auto num_present =
+            cp_model.NewIntVar({0, n}).WithName(std::format("num_present_{}", machine_id));
+        cp_model.AddEquality(num_present, LinearExpr::Sum(presences));
+
+        std::vector<IntVar>     rank_tasks;
+        std::vector<LinearExpr> rank_task_exprs;
+        for (int i = 0; i < n; ++i) {
+            cp_model.AddLessOrEqual(positions[i], n - 1);
+            cp_model.AddLessThan(positions[i], num_present).OnlyEnforceIf(presences[i]);
+            cp_model.AddGreaterOrEqual(positions[i], num_present).OnlyEnforceIf(~presences[i]);
+            rank_tasks.push_back(cp_model.NewIntVar({0, n - 1}).WithName(
+                std::format("rank_task_{}_{}", machine_id, i)));
+            rank_task_exprs.push_back(rank_tasks.back());
+        }
+        cp_model.AddInverseConstraint(positions, rank_tasks);
+
+        // the predecessor of each task is the task at the rank before it, its changeover is looked
+        // up in the row of the task: n entries per task, n^2 per machine
+        std::vector<int64_t> setup_row(n), same_reticle_row(n);
+        for (int to = 0; to < n; ++to) {
+            const auto suffix   = std::format("_{}_{}", machine_id, to);
+            const auto reticle2 = inst_data.job_reticle_pairs.at(job_ids[to]);
+            for (int from = 0; from < n; ++from) {
+                const auto reticle1    = inst_data.job_reticle_pairs.at(job_ids[from]);
+                same_reticle_row[from] = from != to and reticle1 == reticle2 ? 1 : 0;
+                setup_row[from]        = from != to and reticle1 != reticle2
+                                             ? changeovers.get_task_setup_time(machine_id, from, to)
+                                             : 0;
+            }
+
+            // the first task points to itself, its predecessor constraints are not enforced
+            auto first = cp_model.NewBoolVar().WithName("rank_first" + suffix);
+            cp_model.AddEquality(positions[to], 0).OnlyEnforceIf(first);
+            cp_model.AddGreaterOrEqual(positions[to], 1).OnlyEnforceIf(~first);
+
+            auto previous_rank = cp_model.NewIntVar({0, n - 1}).WithName("rank_previous" + suffix);
+            cp_model.AddMaxEquality(previous_rank, {positions[to] - 1, LinearExpr(0)});
+
+            auto previous = cp_model.NewIntVar({0, n - 1}).WithName("rank_predecessor" + suffix);
+            auto previous_end =
+                cp_model.NewIntVar({0, horizon}).WithName("rank_previous_end" + suffix);
+            auto previous_sharing = cp_model.NewIntVar({1, max_sharing_limit})
+                                        .WithName("rank_previous_sharing" + suffix);
+            auto changeover =
+                cp_model.NewIntVar({0, horizon}).WithName("rank_changeover" + suffix);
+            auto same_reticle = cp_model.NewBoolVar().WithName("rank_same_reticle" + suffix);
+            cp_model.AddElement(previous_rank, rank_task_exprs, previous);
+            cp_model.AddElement(previous, ends, previous_end);
+            cp_model.AddElement(previous, sharings, previous_sharing);
+            cp_model.AddElement(previous, setup_row, changeover);
+            cp_model.AddElement(previous, same_reticle_row, same_reticle);
+
+            // start time of the first task >= transfer time + setup time
+            cp_model.AddLessOrEqual(transfers[to] + setups[to], starts[to])
+                .OnlyEnforceIf({presences[to], first});
+
+            cp_model.AddGreaterOrEqual(setups[to], changeover)
+                .OnlyEnforceIf({presences[to], ~first});
+            cp_model.AddLessOrEqual(previous_end + setups[to] + transfers[to], starts[to])
+                .OnlyEnforceIf({presences[to], ~first});
+            if (inst_data.reticle_usage_rule == ReticleUsageRule::MachineRun) {
+                cp_model.AddGreaterOrEqual(sharings[to], previous_sharing + 1)
+                    .OnlyEnforceIf({presences[to], ~first, same_reticle});
+            }
+        }
+
+        if (DEBUG) {
+            std::cout << "Machine: " << machine_id << ", Ranked Tasks: " << n
+                      << ", Setup Rows: " << n * n << std::endl;
+        }
+    }
+}
+
+namespace {
+
+// campaign count of the first task of a reticle: it goes on from the initial usage, or the reticle
+// is requalified first if the initial usage is at the limit. a reticle that can't reach its limit
+// (no limit literal) only counts on
+void add_campaign_start_constraints(CpModelBuilder& cp_model, const TaskVars& task_vars,
+                                    const InstData& inst_data, TaskID task_id, BoolVar start_lit)
+{
+    if (inst_data.reticle_usage_rule != ReticleUsageRule::Campaign) {
+        return;
+    }
+    const auto reticle_id  = inst_data.job_reticle_pairs.at(task_id.first);
+    const auto init_usage  = inst_data.reticle_init_usage.at(reticle_id);
+    const auto limit       = inst_data.reticle_sharing_limits.at(reticle_id);
+    const auto sharing_var = task_vars.reticle_sharing_vars.at(task_id);
+
+    if (init_usage < limit or !task_vars.reticle_limit_vars.contains(task_id)) {
+        cp_model.AddEquality(sharing_var, init_usage + 1).OnlyEnforceIf(start_lit);
+        return;
+    }
+    cp_model.AddEquality(sharing_var, 1).OnlyEnforceIf(start_lit);
+    cp_model
+        .AddGreaterOrEqual(task_vars.task_start_vars.at(task_id),
+                           task_vars.task_transfer_vars.at(task_id) +
+                               task_vars.task_setup_vars.at(task_id) + REQUALIFICATION_TIME)
+        .OnlyEnforceIf(start_lit);
+}
+
+// campaign count along a reticle arc: one more use, or a requalification after a task at the
+// limit. the counts are equalities, so they propagate both ways along the circuit
+void add_campaign_arc_constraints(CpModelBuilder& cp_model, const TaskVars& task_vars,
+                                  const InstData& inst_data, TaskID task1, TaskID task2,
+                                  BoolVar adjacency)
+{
+    if (inst_data.reticle_usage_rule != ReticleUsageRule::Campaign) {
+        return;
+    }
+    const auto sharing1  = task_vars.reticle_sharing_vars.at(task1);
+    const auto sharing2  = task_vars.reticle_sharing_vars.at(task2);
+    const auto limit_var = task_vars.reticle_limit_vars.find(task1);
+    if (limit_var == task_vars.reticle_limit_vars.end()) {
+        cp_model.AddEquality(sharing2, sharing1 + 1).OnlyEnforceIf(adjacency);
+        return;
+    }
+
+    cp_model.AddEquality(sharing2, sharing1 + 1).OnlyEnforceIf({adjacency, ~limit_var->second});
+    cp_model.AddEquality(sharing2, 1).OnlyEnforceIf({adjacency, limit_var->second});
+    cp_model
+        .AddLessOrEqual(task_vars.task_end_vars.at(task1) + task_vars.task_setup_vars.at(task2) +
+                            task_vars.task_transfer_vars.at(task2) + REQUALIFICATION_TIME,
+                        task_vars.task_start_vars.at(task2))
+        .OnlyEnforceIf({adjacency, limit_var->second});
+}
+
+}   // namespace
+
+void add_transfer_constraints(CpModelBuilder& cp_model, TaskVars& task_vars,
+                              const InstData& inst_data, const ArcLimits& arc_limits)
+{
+    task_vars.reticle_move_literals.clear();
+    task_vars.reticle_arc_literals.clear();
+
     // for all tasks, add the TaskID to the vector of each reticle
     std::map<ReticleID, std::vector<TaskID>> reticle_local_tasks_map;
     for (const auto& [task_id, _] : task_vars.task_optional_interval_vars) {
@@ -614,6 +1531,7 @@ void add_transfer_constraints(CpModelBuilder& cp_model, const TaskVars& task_var
     // for each reticle,
     for (const auto& [reticle_id, task_ids] : reticle_local_tasks_map) {
         CircuitConstraint circuit = cp_model.AddCircuitConstraint();
+        const auto        ranks   = find_due_time_ranks(task_ids, inst_data);
 
         for (auto id1 = 0; id1 < task_ids.size(); ++id1) {
             const auto task1            = task_ids[id1];
@@ -632,8 +1550,11 @@ void add_transfer_constraints(CpModelBuilder& cp_model, const TaskVars& task_var
             cp_model.AddImplication(start_lit, task_vars.task_presence_vars.at(task1));
             cp_model.AddImplication(last_lit, task_vars.task_presence_vars.at(task1));
 
+            add_campaign_start_constraints(cp_model, task_vars, inst_data, task1, start_lit);
+
             // if the init position of reticle1 is current machine.
-            if (init_position1 == machine1) {
+            if (init_position1 == machine1 and
+                inst_data.reticle_usage_rule == ReticleUsageRule::MachineRun) {
                 // then the reticle sharing count = initial reticle usage + 1, if start_lit is true
                 cp_model
                     .AddGreaterOrEqual(task_vars.reticle_sharing_vars.at(task1), init_usage1 + 1)
@@ -642,14 +1563,17 @@ void add_transfer_constraints(CpModelBuilder& cp_model, const TaskVars& task_var
 
             // else: if the init position of reticle1 is not current machine.
             if (init_position1 != machine1) {
+                task_vars.reticle_move_literals[task1].push_back(start_lit);
+
                 // transfer time is needed
-                const auto transfer_time1 = inst_data.transfer_times.at({init_position1, machine1});
+                const auto transfer_time1 =
+                    inst_data.changeovers.get_transfer_time(init_position1, machine1);
                 cp_model.AddGreaterOrEqual(task_vars.task_transfer_vars.at(task1), transfer_time1)
                     .OnlyEnforceIf(start_lit);
 
-                // setup time is needed (assume the first setup time is 3)
-                TimeDuration setup_time1 = 2;
-                cp_model.AddGreaterOrEqual(task_vars.task_setup_vars.at(task1), setup_time1)
+                // setup time is needed after the transfer
+                cp_model
+                    .AddGreaterOrEqual(task_vars.task_setup_vars.at(task1), TRANSFER_SETUP_TIME)
                     .OnlyEnforceIf(start_lit);
 
                 // start time of the task >= transfer time + setup time
@@ -668,10 +1592,19 @@ void add_transfer_constraints(CpModelBuilder& cp_model, const TaskVars& task_var
 
                 const auto task2            = task_ids[id2];
                 const auto [job2, machine2] = task2;
+                if (!keep_arc(arc_limits, task1, task2, ranks[id1], ranks[id2])) {
+                    continue;
+                }
 
-                auto adjacency = cp_model.NewBoolVar().WithName(
-                    std::format("reticle_adjacency_{}_{}_{}_{}", job1, machine1, job2, machine2));
+                auto adjacency = cp_model.NewBoolVar();
+                if (arc_limits.with_names) {
+                    adjacency.WithName(std::format(
+                        "reticle_adjacency_{}_{}_{}_{}", job1, machine1, job2, machine2));
+                }
                 circuit.AddArc(id1 + 1, id2 + 1, adjacency);
+                if (arc_limits.record_literals) {
+                    task_vars.reticle_arc_literals.insert({{task1, task2}, adjacency});
+                }
 
                 // # precent constraints
                 cp_model
@@ -686,6 +1619,8 @@ void add_transfer_constraints(CpModelBuilder& cp_model, const TaskVars& task_var
                                         task_vars.task_transfer_vars.at(task2),
                                     task_vars.task_start_vars.at(task2))
                     .OnlyEnforceIf(adjacency);
+                add_campaign_arc_constraints(
+                    cp_model, task_vars, inst_data, task1, task2, adjacency);
 
                 // if they are processed on the same machine [may not be needed, because we already
                 // have the constraint on setup constraints]
@@ -699,155 +1634,213 @@ void add_transfer_constraints(CpModelBuilder& cp_model, const TaskVars& task_var
 
                 // if they are processed on different machines
                 if (machine1 != machine2) {
+                    task_vars.reticle_move_literals[task2].push_back(adjacency);
+
                     // # transfer time constraints
-                    const auto transfer_time2 = inst_data.transfer_times.at({machine1, machine2});
+                    const auto transfer_time2 =
+                        inst_data.changeovers.get_transfer_time(machine1, machine2);
                     cp_model
                         .AddGreaterOrEqual(task_vars.task_transfer_vars.at(task2), transfer_time2)
                         .OnlyEnforceIf(adjacency);
 
                     // # setup time constraints
-                    const auto setup_time2 = 2;
-                    cp_model.AddGreaterOrEqual(task_vars.task_setup_vars.at(task2), setup_time2)
+                    cp_model
+                        .AddGreaterOrEqual(task_vars.task_setup_vars.at(task2),
+                                           TRANSFER_SETUP_TIME)
                         .OnlyEnforceIf(adjacency);
                 }
             }
         }
     }
+}
+
+void add_transfer_constraints_by_id(CpModelBuilder& cp_model, TaskVars& task_vars,
+                                    const InstData& inst_data, const ArcLimits& arc_limits)
+{
+    task_vars.reticle_move_literals.clear();
+    task_vars.reticle_arc_literals.clear();
 
+    // same reticle circuits as add_transfer_constraints, but the nodes are the global task ids
+    // (shared by all the reticles, nodes without arcs are ignored by the circuit constraint), and
+    // the transfer time is fixed by the selected arc instead of only bounded from below
+    std::map<TaskID, int> task_node_ids;
+    for (const auto& [task_id, _] : task_vars.task_optional_interval_vars) {
+        const auto node_id     = static_cast<int>(task_node_ids.size()) + 1;   // 0 is the depot
+        task_node_ids[task_id] = node_id;
+    }
 
+    std::map<ReticleID, std::vector<TaskID>> reticle_local_tasks_map;
+    for (const auto& [task_id, _] : task_node_ids) {
+        const auto reticle_id = inst_data.job_reticle_pairs.at(task_id.first);
+        reticle_local_tasks_map[reticle_id].push_back(task_id);
+    }
 
+    // for each reticle,
+    for (const auto& [reticle_id, task_ids] : reticle_local_tasks_map) {
+        CircuitConstraint circuit       = cp_model.AddCircuitConstraint();
+        const auto        init_position = inst_data.reticle_init_positions.at(reticle_id);
+        const auto        init_usage    = inst_data.reticle_init_usage.at(reticle_id);
+
+        std::map<TaskID, int> task_ranks;
+        const auto            ranks = find_due_time_ranks(task_ids, inst_data);
+        for (size_t i = 0; i < task_ids.size(); ++i) {
+            task_ranks[task_ids[i]] = ranks[i];
+        }
 
+        for (const auto& task1 : task_ids) {
+            const auto [job1, machine1] = task1;
+            const auto id1              = task_node_ids.at(task1);
+            const auto presence1        = task_vars.task_presence_vars.at(task1);
+
+            auto start_lit = cp_model.NewBoolVar().WithName(
+                std::format("reticle_{}_start_at_{}_{}", reticle_id, job1, machine1));
+            auto last_lit = cp_model.NewBoolVar().WithName(
+                std::format("reticle_{}_last_at_{}_{}", reticle_id, job1, machine1));
+
+            circuit.AddArc(0, id1, start_lit);
+            circuit.AddArc(id1, 0, last_lit);
+            circuit.AddArc(id1, id1, ~presence1);
+            cp_model.AddImplication(start_lit, presence1);
+            cp_model.AddImplication(last_lit, presence1);
+
+            add_campaign_start_constraints(cp_model, task_vars, inst_data, task1, start_lit);
+
+            // 1. the reticle is already on the machine: no transfer, the sharing count goes on
+            // from the initial usage
+            if (init_position == machine1) {
+                cp_model.AddEquality(task_vars.task_transfer_vars.at(task1), 0)
+                    .OnlyEnforceIf(start_lit);
+                if (inst_data.reticle_usage_rule == ReticleUsageRule::MachineRun) {
+                    cp_model
+                        .AddGreaterOrEqual(task_vars.reticle_sharing_vars.at(task1),
+                                           init_usage + 1)
+                        .OnlyEnforceIf(start_lit);
+                }
+            }
+            // 2. else the reticle is transferred from its initial position and setup
+            if (init_position != machine1) {
+                task_vars.reticle_move_literals[task1].push_back(start_lit);
 
+                const auto transfer_time1 =
+                    inst_data.changeovers.get_transfer_time(init_position, machine1);
+                cp_model.AddEquality(task_vars.task_transfer_vars.at(task1), transfer_time1)
+                    .OnlyEnforceIf(start_lit);
 
+                cp_model
+                    .AddGreaterOrEqual(task_vars.task_setup_vars.at(task1), TRANSFER_SETUP_TIME)
+                    .OnlyEnforceIf(start_lit);
 
-    // // for each reticle,
-    // for (const auto& [reticle_id, task_ids] : reticle_local_tasks_map) {
-    //     CircuitConstraint circuit = cp_model.AddCircuitConstraint();
-    //     // for each pair of tasks
-    //     for (const auto& task1 : task_ids) {
-    //         const auto [job1, machine1]      = task1;
-    //         unsigned long long id1           = job1 * 1000 + machine1 + 1;
-    //         auto               init_position = inst_data.reticle_init_positions.at(reticle_id);
-    //         auto               initial_usage = inst_data.reticle_init_usage.at(reticle_id);
-
-    //         auto start_lit_name =
-    //             std::format("reticle_{}_start_at_{}_{}", reticle_id, job1, machine1);
-    //         auto start_literals = cp_model.NewBoolVar().WithName(start_lit_name);
-    //         circuit.AddArc(0, id1, start_literals);
-
-    //         // if job1 is the first job on the reticle, then:
-    //         // #0. the task1 is presence
-    //         cp_model.AddEquality(task_vars.task_presence_vars.at(task1), 1)
-    //             .OnlyEnforceIf(start_literals);
-
-    //         // 1. if the reticle's init position is the same as the machine, and the job
-    //         // which use the reticle, then the reticle sharing count >= init usage, no setup
-    //         // time is needed, no transfer time is needed
-    //         if (init_position == machine1) {
-    //             cp_model
-    //                 .AddGreaterOrEqual(task_vars.reticle_sharing_vars.at(task1), initial_usage +
-    //                 1) .OnlyEnforceIf(start_literals);
-    //         }
-    //         // else, the retilce is at another machine, then the transfer time is needed
-    //         // setup time is needed, reticle sharing count = 1
-    //         if (init_position != machine1) {
-    //             auto trans_time1 = inst_data.transfer_times.at({init_position, machine1});
-
-    //             // precedence constraint: transfer time + setup time  <= task2
-    //             cp_model.AddLessOrEqual(trans_time1 + 3, task_vars.task_start_vars.at(task1))
-    //                 .OnlyEnforceIf(start_literals);
-
-    //             // we assume the first setup time is 3.
-    //             // In practice, the setup time should be depend on [m,r,r]
-    //             cp_model.AddGreaterOrEqual(task_vars.task_setup_vars.at(task1), 3)
-    //                 .OnlyEnforceIf(start_literals);
-
-    //             cp_model.AddGreaterOrEqual(task_vars.task_transfer_vars.at(task1), trans_time1)
-    //                 .OnlyEnforceIf(start_literals);
-
-    //             // cp_model.AddEquality(task_vars.reticle_sharing_vars.at(task1), 1)
-    //             //     .OnlyEnforceIf(start_literals);
-    //         }
-
-
-    //         // add the arc from the last job to 0
-    //         auto last_lit_name =
-    //             std::format("reticle_{}_last_at_{}_{}", reticle_id, job1, machine1);
-    //         auto last_literals = cp_model.NewBoolVar().WithName(last_lit_name);
-    //         circuit.AddArc(id1, 0, last_literals);
-
-    //         for (const auto& task2 : task_ids) {
-    //             const auto [job2, machine2] = task2;
-    //             unsigned long long id2      = job2 * 1000 + machine2 + 1;
-
-    //             if (job1 == job2 && machine1 == machine2) {
-    //                 continue;
-    //             }
-
-    //             auto adjacency_name = std::format("reticle_{}_adjacency_{}_{}_to_{}——{}",
-    //                                               reticle_id,
-    //                                               job1,
-    //                                               machine1,
-    //                                               job2,
-    //                                               machine2);
-    //             auto adjacency      = cp_model.NewBoolVar().WithName(adjacency_name);
-    //             circuit.AddArc(id1, id2, adjacency);
-
-
-    //             auto trans_time2 = inst_data.transfer_times.at({machine1, machine2});
-
-    //             // if job1 is processed before job2 on the same reticle, then:
-    //             // 0. the both task is presence
-    //             cp_model
-    //                 .AddBoolAnd({task_vars.task_presence_vars.at(task1),
-    //                              task_vars.task_presence_vars.at(task2)})
-    //                 .OnlyEnforceIf(adjacency);
-
-    //             // 1. if they are processed on the same machine, then the transfer time = 0
-    //             // setup time = 0, reticle sharing count += 1
-    //             if (machine1 == machine2) {
-    //                 // precedence constraint
-    //                 // cp_model
-    //                 //     .AddLessOrEqual(task_vars.task_end_vars.at(task1),
-    //                 //                     task_vars.task_start_vars.at(task2))
-    //                 //     .OnlyEnforceIf(adjacency);
-
-    //                 // reticle sharing count += 1
-    //                 cp_model
-    //                     .AddGreaterOrEqual(task_vars.reticle_sharing_vars.at(task2),
-    //                                        task_vars.reticle_sharing_vars.at(task1) + 1)
-    //                     .OnlyEnforceIf(adjacency);
-    //             }
-    //             // 2. if they are processed on different machines, then the transfer time is
-    //             // needed and setup time is needed, reticle sharing count = 1
-    //             if (machine1 != machine2) {
-    //                 // transfer time = transfer time from machine1 to machine2
-    //                 cp_model.AddEquality(task_vars.task_transfer_vars.at(task2), trans_time2)
-    //                     .OnlyEnforceIf(adjacency);
-
-    //                 // precedence constraint: task1 + transfer time + setup time <= task2
-    //                 // where the setup time is handled by the setup constraint
-    //                 cp_model
-    //                     .AddLessOrEqual(task_vars.task_end_vars.at(task1) +
-    //                                         task_vars.task_transfer_vars.at(task2) +
-    //                                         task_vars.task_setup_vars.at(task2),
-    //                                     task_vars.task_start_vars.at(task2))
-    //                     .OnlyEnforceIf(adjacency);
-    //             }
-    //         }
-    //     }
-    // }
+                cp_model
+                    .AddGreaterOrEqual(task_vars.task_start_vars.at(task1),
+                                       task_vars.task_transfer_vars.at(task1) +
+                                           task_vars.task_setup_vars.at(task1))
+                    .OnlyEnforceIf(start_lit);
+            }
+
+            for (const auto& task2 : task_ids) {
+                if (task1 == task2) {
+                    continue;
+                }
+
+                const auto [job2, machine2] = task2;
+                const auto id2              = task_node_ids.at(task2);
+                const auto rank1 = task_ranks.at(task1), rank2 = task_ranks.at(task2);
+                if (!keep_arc(arc_limits, task1, task2, rank1, rank2)) {
+                    continue;
+                }
+
+                auto adjacency = cp_model.NewBoolVar();
+                if (arc_limits.with_names) {
+                    adjacency.WithName(std::format("reticle_{}_adjacency_{}_{}_to_{}_{}",
+                                                   reticle_id,
+                                                   job1,
+                                                   machine1,
+                                                   job2,
+                                                   machine2));
+                }
+                circuit.AddArc(id1, id2, adjacency);
+                if (arc_limits.record_literals) {
+                    task_vars.reticle_arc_literals.insert({{task1, task2}, adjacency});
+                }
+
+                cp_model
+                    .AddBoolAnd({task_vars.task_presence_vars.at(task1),
+                                 task_vars.task_presence_vars.at(task2)})
+                    .OnlyEnforceIf(adjacency);
+
+                // precedence constraint: task1 + transfer time + setup time <= task2
+                cp_model
+                    .AddLessOrEqual(task_vars.task_end_vars.at(task1) +
+                                        task_vars.task_setup_vars.at(task2) +
+                                        task_vars.task_transfer_vars.at(task2),
+                                    task_vars.task_start_vars.at(task2))
+                    .OnlyEnforceIf(adjacency);
+                add_campaign_arc_constraints(
+                    cp_model, task_vars, inst_data, task1, task2, adjacency);
+
+                // transfer time = transfer time from machine1 to machine2 (0 on the same machine)
+                const auto transfer_time2 =
+                    inst_data.changeovers.get_transfer_time(machine1, machine2);
+                cp_model.AddEquality(task_vars.task_transfer_vars.at(task2), transfer_time2)
+                    .OnlyEnforceIf(adjacency);
+
+                if (machine1 != machine2) {
+                    task_vars.reticle_move_literals[task2].push_back(adjacency);
+
+                    // setup time is needed after a transfer
+                    cp_model
+                        .AddGreaterOrEqual(task_vars.task_setup_vars.at(task2),
+                                           TRANSFER_SETUP_TIME)
+                        .OnlyEnforceIf(adjacency);
+                }
+            }
+        }
+    }
 }
 
 
+void add_transport_capacity_constraints(CpModelBuilder& cp_model, TaskVars& task_vars,
+                                        int capacity)
+{
+    // one optional transfer interval for each task reached by a reticle move, present when one of
+    // its cross-machine arcs is selected (at most one is). the reticle is in flight just before
+    // the setup: [start - setup - transfer, start - setup)
+    task_vars.task_transfer_interval_vars.clear();
+
+    auto cumulative = cp_model.AddCumulative(capacity);
+    for (const auto& [task_id, move_literals] : task_vars.reticle_move_literals) {
+        const auto [job_id, machine_id] = task_id;
+        std::string suffix              = std::format("_{}_{}", job_id, machine_id);
+
+        auto moved = cp_model.NewBoolVar().WithName(std::string("reticle_moved") + suffix);
+        cp_model.AddEquality(LinearExpr::Sum(move_literals), moved);
+
+        const auto transfer = task_vars.task_transfer_vars.at(task_id);
+        const auto arrival =
+            task_vars.task_start_vars.at(task_id) - task_vars.task_setup_vars.at(task_id);
+        auto interval =
+            cp_model.NewOptionalIntervalVar(arrival - transfer, transfer, arrival, moved)
+                .WithName(std::string("transfer_interval") + suffix);
+
+        task_vars.task_transfer_interval_vars[task_id] = interval;
+        cumulative.AddDemand(interval, 1);
+    }
+
+    if (DEBUG) {
+        std::cout << "Transport capacity: " << capacity << ", transfer intervals: "
+                  << task_vars.task_transfer_interval_vars.size() << std::endl;
+    }
+}
+
 void add_obj_minimize_makespan(CpModelBuilder& cp_model, const TaskVars& task_vars,
                                std::vector<IntVar>& obj_exprs, TimeStamp horizon)
 {
     // add the objective makespan
     auto makespan = cp_model.NewIntVar({0, horizon}).WithName("makespan");
 
+    // only the job level end vars, the absent alternatives have no end time to bound
     std::vector<IntVar> end_vars;
-    for (const auto& [task_id, end_var] : task_vars.task_end_vars) {
+    for (const auto& [job_id, end_var] : task_vars.job_end_vars) {
         end_vars.push_back(end_var);
     }
 
@@ -903,16 +1896,20 @@ void add_obj_minimize_setup_time(CpModelBuilder& cp_model, const TaskVars& task_
 }
 
 void add_obj_minimize_tardiness(CpModelBuilder& cp_model, const TaskVars& task_vars,
-                                std::vector<IntVar>& obj_exprs, const InstData& inst_data)
+                                std::vector<IntVar>& obj_exprs, const InstData& inst_data,
+                                ModelIndex& model_index)
 {
+    model_index.job_tardiness_constraints.clear();
+
     // add the objective minimize tardiness
     IntVar total_tardiness = cp_model.NewIntVar({0, 100000}).WithName("total_tardiness");
 
     std::vector<IntVar> tardiness_vars;
-    for (const auto& [task_id, end_var] : task_vars.task_end_vars) {
-        const auto [job_id, machine_id] = task_id;
-        auto due_time                   = inst_data.job_due_times.at(job_id);
-        auto tardiness                  = cp_model.NewIntVar({0, 100000}).WithName("tardiness");
+    for (const auto& [job_id, end_var] : task_vars.job_end_vars) {
+        auto due_time  = inst_data.job_due_times.at(job_id);
+        auto tardiness =
+            cp_model.NewIntVar({0, 100000}).WithName(std::format("tardiness_{}", job_id));
+        model_index.job_tardiness_constraints[job_id] = cp_model.Proto().constraints_size();
         cp_model.AddMaxEquality(tardiness, {0, end_var - due_time});
         tardiness_vars.push_back(tardiness);
     }
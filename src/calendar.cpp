@@ -0,0 +1,73 @@
+#include <algorithm>
+
+#include "calendar.hpp"
+#include "types.hpp"
+
+namespace operations_research {
+namespace sat {
+
+std::vector<TimeWindow> merge_time_windows(std::vector<TimeWindow> windows)
+{
+    std::sort(windows.begin(), windows.end());
+
+    std::vector<TimeWindow> merged;
+    for (const auto& [start, end] : windows) {
+        if (start >= end) {
+            continue;
+        }
+        if (!merged.empty() and start <= merged.back().second) {
+            merged.back().second = std::max(merged.back().second, end);
+        }
+        else {
+            merged.push_back({start, end});
+        }
+    }
+
+    return merged;
+}
+
+TimeStamp find_available_start(const InstData& inst_data, MachineID machine_id, TimeStamp start,
+                               TimeDuration duration)
+{
+    const auto it = inst_data.machine_downtimes.find(machine_id);
+    if (it == inst_data.machine_downtimes.end()) {
+        return start;
+    }
+
+    // first window ending after start, then jump over the windows the task would overlap
+    const auto& windows = it->second;
+    auto        window  = std::upper_bound(
+        windows.begin(), windows.end(), start, [](TimeStamp time, const TimeWindow& window) {
+            return time < window.second;
+        });
+    while (window != windows.end() and window->first < start + duration) {
+        start = std::max(start, window->second);
+        ++window;
+    }
+
+    return start;
+}
+
+TimeDuration find_downtime_overlap(const InstData& inst_data, MachineID machine_id,
+                                   TimeStamp start, TimeStamp end)
+{
+    const auto it = inst_data.machine_downtimes.find(machine_id);
+    if (it == inst_data.machine_downtimes.end() or end <= start) {
+        return 0;
+    }
+
+    const auto&  windows = it->second;
+    TimeDuration overlap = 0;
+    auto         window  = std::upper_bound(
+        windows.begin(), windows.end(), start, [](TimeStamp time, const TimeWindow& window) {
+            return time < window.second;
+        });
+    for (; window != windows.end() and window->first < end; ++window) {
+        overlap += std::min(end, window->second) - std::max(start, window->first);
+    }
+
+    return overlap;
+}
+
+}   // namespace sat
+}   // namespace operations_research
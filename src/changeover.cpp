@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <map>
+
+#include "changeover.hpp"
+#include "types.hpp"
+
+namespace operations_research {
+namespace sat {
+constexpr bool DEBUG = true;
+
+int ChangeoverTable::get_local_index(MachineID machine_id, JobID job_id) const
+{
+    if (machine_id >= blocks_.size()) {
+        return -1;
+    }
+    const auto& jobs = blocks_[machine_id].jobs;
+    const auto  it   = std::lower_bound(jobs.begin(), jobs.end(), job_id);
+    return it != jobs.end() and *it == job_id ? it - jobs.begin() : -1;
+}
+
+std::size_t SetupFamilies::bytes() const
+{
+    std::size_t bytes = machine_families_.capacity() * sizeof(int);
+    for (const auto& matrix : matrices_) {
+        bytes += matrix.capacity() * sizeof(TimeDuration);
+    }
+    return bytes;
+}
+
+void SetupFamilies::set_matrix(MachineID machine_id, std::vector<TimeDuration> matrix)
+{
+    if (machine_id >= machine_families_.size()) {
+        machine_families_.resize(machine_id + 1, -1);
+    }
+    // few families (scanner models), a linear search is enough
+    const auto it = std::find(matrices_.begin(), matrices_.end(), matrix);
+    if (it != matrices_.end()) {
+        machine_families_[machine_id] = it - matrices_.begin();
+        return;
+    }
+    machine_families_[machine_id] = matrices_.size();
+    matrices_.push_back(std::move(matrix));
+}
+
+void build_changeover_table(InstData& inst_data, std::size_t max_task_setup_bytes)
+{
+    ChangeoverTable table;
+
+    // ids are small and dense, the matrices are indexed by them directly
+    std::size_t max_machine_id = 0, max_reticle_id = 0;
+    for (const auto& [task_id, _] : inst_data.processing_times) {
+        max_machine_id = std::max<std::size_t>(max_machine_id, task_id.second);
+    }
+    for (const auto& [machine_pair, _] : inst_data.transfer_times) {
+        max_machine_id = std::max<std::size_t>(
+            max_machine_id, std::max(machine_pair.first, machine_pair.second));
+    }
+    const auto& setup_families = inst_data.setup_times;
+    if (setup_families.num_machines() > 0) {
+        max_machine_id = std::max(max_machine_id, setup_families.num_machines() - 1);
+    }
+    if (setup_families.num_reticles() > 0) {
+        max_reticle_id = std::max(max_reticle_id, setup_families.num_reticles() - 1);
+    }
+    for (const auto& [_, reticle_id] : inst_data.job_reticle_pairs) {
+        max_reticle_id = std::max<std::size_t>(max_reticle_id, reticle_id);
+    }
+    table.num_machines_ = max_machine_id + 1;
+    table.num_reticles_ = max_reticle_id + 1;
+
+    // family x reticle x reticle setups, the machines without setups share an extra zero family,
+    // machine x machine transfers
+    const auto num_families   = setup_families.num_families();
+    const auto num_reticles   = table.num_reticles_;
+    table.machine_families_.assign(table.num_machines_, num_families);
+    for (std::size_t machine_id = 0; machine_id < table.num_machines_; ++machine_id) {
+        const auto family = setup_families.get_family(machine_id);
+        if (family >= 0) {
+            table.machine_families_[machine_id] = family;
+        }
+    }
+    table.reticle_setups_.assign((num_families + 1) * num_reticles * num_reticles, 0);
+    for (std::size_t family = 0; family < num_families; ++family) {
+        const auto& matrix = setup_families.get_matrix(family);
+        const auto  size   = setup_families.num_reticles();
+        for (std::size_t from = 0; from < size; ++from) {
+            for (std::size_t to = 0; to < size; ++to) {
+                if (from != to) {
+                    table.reticle_setups_[(family * num_reticles + from) * num_reticles + to] =
+                        matrix[from * size + to];
+                }
+            }
+        }
+    }
+
+    table.transfers_.assign(table.num_machines_ * table.num_machines_, 0);
+    for (const auto& [machine_pair, transfer_time] : inst_data.transfer_times) {
+        const auto [from_machine, to_machine] = machine_pair;
+        if (from_machine != to_machine) {
+            table.transfers_[from_machine * table.num_machines_ + to_machine] = transfer_time;
+        }
+    }
+
+    table.min_transfers_in_.assign(table.num_machines_, 0);
+    table.min_transfers_out_.assign(table.num_machines_, 0);
+    for (std::size_t machine = 0; machine < table.num_machines_; ++machine) {
+        auto min_in  = std::numeric_limits<TimeDuration>::max();
+        auto min_out = std::numeric_limits<TimeDuration>::max();
+        for (std::size_t other = 0; other < table.num_machines_; ++other) {
+            if (other != machine) {
+                min_in  = std::min(min_in, table.get_transfer_time(other, machine));
+                min_out = std::min(min_out, table.get_transfer_time(machine, other));
+            }
+        }
+        if (table.num_machines_ > 1) {
+            table.min_transfers_in_[machine]  = min_in;
+            table.min_transfers_out_[machine] = min_out;
+        }
+    }
+
+    // local task indices of each machine, processing_times is in (job_id, machine_id) order so
+    // the jobs of each machine are sorted
+    table.blocks_.resize(table.num_machines_);
+    for (const auto& [task_id, _] : inst_data.processing_times) {
+        const auto [job_id, machine_id] = task_id;
+        table.blocks_[machine_id].jobs.push_back(job_id);
+        table.blocks_[machine_id].reticles.push_back(inst_data.job_reticle_pairs.at(job_id));
+    }
+
+    // smallest setup from / to the other tasks of each machine, over the reticles of the machine
+    // rather than the task pairs
+    for (std::size_t machine_id = 0; machine_id < table.num_machines_; ++machine_id) {
+        auto&      block    = table.blocks_[machine_id];
+        const auto num_jobs = block.jobs.size();
+        if (num_jobs == 0) {
+            continue;
+        }
+        table.machines_.push_back(machine_id);
+
+        std::map<ReticleID, int> reticle_counts;
+        for (const auto reticle_id : block.reticles) {
+            reticle_counts[reticle_id]++;
+        }
+        block.min_setups_in.assign(num_jobs, std::numeric_limits<TimeDuration>::max());
+        block.min_setups_out.assign(num_jobs, std::numeric_limits<TimeDuration>::max());
+        for (std::size_t task = 0; task < num_jobs; ++task) {
+            const auto reticle_id = block.reticles[task];
+            for (const auto& [other, count] : reticle_counts) {
+                if (other == reticle_id and count == 1) {   // only the task itself
+                    continue;
+                }
+                const auto setup_out = table.get_setup_time(machine_id, reticle_id, other);
+                const auto setup_in  = table.get_setup_time(machine_id, other, reticle_id);
+                block.min_setups_out[task] = std::min(block.min_setups_out[task], setup_out);
+                block.min_setups_in[task]  = std::min(block.min_setups_in[task], setup_in);
+            }
+        }
+        if (num_jobs == 1) {
+            block.min_setups_in[0]  = 0;
+            block.min_setups_out[0] = 0;
+        }
+    }
+
+    // task x task setups of each machine, rows padded to a cache line
+    constexpr std::size_t line_size = CACHE_LINE_SIZE / sizeof(TimeDuration);
+    std::size_t           offset    = 0;
+    for (const auto machine_id : table.machines_) {
+        auto&      block    = table.blocks_[machine_id];
+        const auto num_jobs = block.jobs.size();
+        block.offset        = offset;
+        block.stride        = (num_jobs + line_size - 1) / line_size * line_size;
+        offset += block.stride * num_jobs;
+    }
+    if (offset * sizeof(TimeDuration) <= max_task_setup_bytes) {
+        table.task_setups_.assign(offset, 0);
+        for (const auto machine_id : table.machines_) {
+            const auto& block    = table.blocks_[machine_id];
+            const auto  num_jobs = block.jobs.size();
+            for (std::size_t from = 0; from < num_jobs; ++from) {
+                for (std::size_t to = 0; to < num_jobs; ++to) {
+                    table.task_setups_[block.offset + from * block.stride + to] =
+                        table.get_setup_time(machine_id, block.reticles[from], block.reticles[to]);
+                }
+            }
+        }
+    }
+
+    if (DEBUG) {
+        std::cout << "Changeover table: " << table.machines_.size() << " machines, "
+                  << table.num_reticles_ << " reticles, " << num_families << " setup families, "
+                  << table.task_setups_.size() << " task setup entries" << std::endl;
+    }
+
+    inst_data.changeovers = std::move(table);
+}
+
+}   // namespace sat
+}   // namespace operations_research
@@ -0,0 +1,395 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "ortools/sat/cp_model.h"
+#include "ortools/sat/model.h"
+#include "ortools/sat/sat_parameters.pb.h"
+
+#include "build_model.hpp"
+#include "changeover.hpp"
+#include "decomposition.hpp"
+#include "evaluator.hpp"
+#include "heuristic.hpp"
+#include "lower_bound.hpp"
+#include "solve_model.hpp"
+#include "types.hpp"
+
+namespace operations_research {
+namespace sat {
+constexpr bool DEBUG = true;
+
+namespace {
+
+struct MasterModel
+{
+    CpModelBuilder              cp_model;
+    std::map<TaskID, BoolVar>   assignment_vars;   // the job is assigned to the machine
+    IntVar                      makespan;
+    std::map<MachineID, IntVar> tardiness_vars;   // estimated tardiness of the machine jobs
+};
+
+struct SubproblemResult
+{
+    MachineID          machine_id;
+    std::vector<JobID> job_ids;
+    CpSolverStatus     status = CpSolverStatus::UNKNOWN;
+    int64_t            bound  = 0;   // of the machine makespan + tardiness
+};
+
+// the assignment of the jobs to the machines, with load and changeover estimates: the smallest
+// setup before each task, and the earliest end and tardiness of each job on each machine. the
+// combinatorial lower bound bounds the makespan and the total tardiness
+void build_master(MasterModel& master, const InstData& inst_data, const LowerBound& lower_bound,
+                  TimeStamp horizon)
+{
+    auto&       cp_model    = master.cp_model;
+    const auto& changeovers = inst_data.changeovers;
+
+    std::map<JobID, std::vector<BoolVar>> job_vars;
+    std::map<JobID, LinearExpr>           job_ends;
+    std::map<MachineID, LinearExpr>       loads;
+    std::map<MachineID, int64_t>          max_setups;   // the first task is not set up
+    std::map<MachineID, LinearExpr>       tardiness_estimates;
+    for (const auto& [task_id, processing_time] : inst_data.processing_times) {
+        const auto [job_id, machine_id] = task_id;
+        auto var = cp_model.NewBoolVar().WithName(std::format("assign_{}_{}", job_id, machine_id));
+        master.assignment_vars[task_id] = var;
+        job_vars[job_id].push_back(var);
+
+        int64_t setup = 0;
+        if (changeovers.has_machine(machine_id)) {
+            const auto local_index = changeovers.get_local_index(machine_id, job_id);
+            setup = local_index >= 0 ? changeovers.get_min_setup_in(machine_id, local_index) : 0;
+        }
+        loads[machine_id] += LinearExpr::Term(var, processing_time + setup);
+        max_setups[machine_id] = std::max(max_setups[machine_id], setup);
+
+        const int64_t end = find_earliest_start(inst_data, task_id) + processing_time;
+        const int64_t due = inst_data.job_due_times.at(job_id);
+        job_ends[job_id] += LinearExpr::Term(var, end);
+        tardiness_estimates[machine_id] += LinearExpr::Term(var, std::max<int64_t>(0, end - due));
+    }
+
+    master.makespan = cp_model
+                          .NewIntVar({lower_bound.makespan,
+                                      std::max<int64_t>(horizon, lower_bound.makespan)})
+                          .WithName("master_makespan");
+    for (const auto& [job_id, vars] : job_vars) {
+        cp_model.AddExactlyOne(vars);
+        cp_model.AddGreaterOrEqual(master.makespan, job_ends.at(job_id));
+    }
+
+    std::vector<IntVar> tardiness_vars;
+    for (const auto& [machine_id, load] : loads) {
+        cp_model.AddGreaterOrEqual(master.makespan, load - max_setups.at(machine_id));
+
+        auto tardiness_var = cp_model.NewIntVar({0, 100000}).WithName(
+            std::format("master_tardiness_{}", machine_id));
+        cp_model.AddGreaterOrEqual(tardiness_var, tardiness_estimates.at(machine_id));
+        master.tardiness_vars[machine_id] = tardiness_var;
+        tardiness_vars.push_back(tardiness_var);
+    }
+    cp_model.AddGreaterOrEqual(LinearExpr::Sum(tardiness_vars), lower_bound.tardiness);
+
+    cp_model.Minimize(master.makespan + LinearExpr::Sum(tardiness_vars));
+}
+
+// the full model of a machine with its assigned jobs only, on the closed changeovers: the
+// reticles are only moved from their initial position, so its bound is a bound of the machine
+// makespan + tardiness in any schedule with these jobs on the machine (more jobs on the machine
+// do not make it smaller)
+void solve_subproblem(SubproblemResult& subproblem, const InstData& fixed_data,
+                      int num_search_workers, int time_limit)
+{
+    InstData machine_data = fixed_data;
+    std::erase_if(machine_data.processing_times, [&](const auto& entry) {
+        return entry.first.second != subproblem.machine_id;
+    });
+    build_changeover_table(machine_data);
+
+    CpModelBuilder      cp_model;
+    TaskVars            task_vars;
+    ModelIndex          model_index;
+    std::vector<IntVar> obj_exprs;
+    build_model(cp_model, task_vars, model_index, obj_exprs, machine_data, BuildOptions());
+
+    Model         model;
+    SatParameters parameters;
+    set_time_limit(parameters, time_limit);
+    set_num_search_workers(parameters, num_search_workers);
+    disable_log_search_progress(parameters);
+    add_parameters_to_model(model, parameters);
+    const auto response = solve_model(model, cp_model);
+
+    subproblem.status = response.status();
+    subproblem.bound  = static_cast<int64_t>(std::ceil(response.best_objective_bound()));
+}
+
+// the shortest path closure of the setups of each family, over the reticles of the instance, and
+// of the transfers between the machines. the closed changeovers meet the triangle inequality, so
+// a machine never gets cheaper with more jobs, and they are never above the instance ones, so a
+// bound on the closure is a bound of the instance
+InstData close_changeovers(const InstData& inst_data)
+{
+    InstData closed_data = inst_data;
+
+    const auto& setup_families = inst_data.setup_times;
+    const auto  size           = setup_families.num_reticles();
+    std::set<ReticleID> reticle_set;
+    for (const auto& [_, reticle_id] : inst_data.job_reticle_pairs) {
+        if (reticle_id < size) {
+            reticle_set.insert(reticle_id);
+        }
+    }
+    const std::vector<ReticleID> reticles(reticle_set.begin(), reticle_set.end());
+
+    std::vector<std::vector<TimeDuration>> matrices;
+    for (std::size_t family = 0; family < setup_families.num_families(); ++family) {
+        auto matrix = setup_families.get_matrix(family);
+        for (const auto b : reticles) {
+            for (const auto a : reticles) {
+                for (const auto c : reticles) {
+                    auto& setup = matrix[a * size + c];
+                    if (a != c and a != b and b != c) {
+                        setup = std::min(setup, matrix[a * size + b] + matrix[b * size + c]);
+                    }
+                }
+            }
+        }
+        matrices.push_back(std::move(matrix));
+    }
+    SetupFamilies closed_setups(size);
+    for (MachineID machine_id = 0; machine_id < setup_families.num_machines(); ++machine_id) {
+        const int family = setup_families.get_family(machine_id);
+        if (family >= 0) {
+            closed_setups.set_matrix(machine_id, matrices[family]);
+        }
+    }
+    closed_data.setup_times = std::move(closed_setups);
+
+    // the missing pairs cost 0, as in the changeover table
+    std::set<MachineID> machine_set;
+    for (const auto& [task_id, _] : inst_data.processing_times) {
+        machine_set.insert(task_id.second);
+    }
+    for (const auto& [_, machine_id] : inst_data.reticle_init_positions) {
+        machine_set.insert(machine_id);
+    }
+    for (const auto& [machine_pair, _] : inst_data.transfer_times) {
+        machine_set.insert(machine_pair.first);
+        machine_set.insert(machine_pair.second);
+    }
+    auto transfer = [&](MachineID from, MachineID to) -> TimeDuration {
+        const auto it = closed_data.transfer_times.find({from, to});
+        return it == closed_data.transfer_times.end() ? 0 : it->second;
+    };
+    for (const auto b : machine_set) {
+        for (auto& [machine_pair, transfer_time] : closed_data.transfer_times) {
+            const auto [a, c] = machine_pair;
+            if (a != c and a != b and b != c) {
+                transfer_time = std::min(transfer_time, transfer(a, b) + transfer(b, c));
+            }
+        }
+    }
+
+    build_changeover_table(closed_data);
+    return closed_data;
+}
+
+}   // namespace
+
+DecompositionResult solve_by_decomposition(const InstData&             inst_data,
+                                           const DecompositionOptions& options)
+{
+    const auto start_time = std::chrono::steady_clock::now();
+    const auto remaining  = [&]() {
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+        return std::max(0, options.time_limit - static_cast<int>(elapsed.count()));
+    };
+
+    const auto  lower_bound = compute_lower_bound(inst_data);
+    MasterModel master;
+    build_master(master, inst_data, lower_bound, find_max_horizon(inst_data));
+
+    DecompositionResult result;
+    result.lower_bound = lower_bound.objective;
+
+    // the subproblems are solved on the closed changeovers, their bounds stay valid when jobs are
+    // added to the machine on any instance
+    const auto closed_data = close_changeovers(inst_data);
+
+    Schedule                              best_assignment;   // job and machine of each task only
+    std::set<std::map<JobID, MachineID>> seen_assignments;
+    while (result.iterations < options.max_iterations and remaining() > 0) {
+        // 1. master problem
+        Model         model;
+        SatParameters parameters;
+        set_time_limit(parameters, std::min(options.master_time_limit, remaining()));
+        set_num_search_workers(parameters, options.num_search_workers);
+        disable_log_search_progress(parameters);
+        add_parameters_to_model(model, parameters);
+        const auto response = solve_model(model, master.cp_model);
+        if (response.status() != CpSolverStatus::OPTIMAL and
+            response.status() != CpSolverStatus::FEASIBLE) {
+            break;
+        }
+        result.iterations++;
+        result.lower_bound = std::max(
+            result.lower_bound, static_cast<int64_t>(std::ceil(response.best_objective_bound())));
+
+        std::map<JobID, MachineID> assignment;
+        Schedule                   assigned;
+        for (const auto& [task_id, var] : master.assignment_vars) {
+            if (SolutionBooleanValue(response, var)) {
+                assignment[task_id.first] = task_id.second;
+                ScheduledTask task        = {};
+                task.job_id               = task_id.first;
+                task.machine_id           = task_id.second;
+                assigned.push_back(task);
+            }
+        }
+
+        // 2. upper bound: the greedy schedule of the assignment
+        const auto fixed_data = fix_machine_assignment(inst_data, assigned);
+        auto       schedule   = greedy_schedule(fixed_data);
+        const auto evaluation = evaluate_schedule(schedule, inst_data);
+        if (evaluation.feasible() and
+            (result.objective < 0 or evaluation.objective < result.objective)) {
+            result.objective = evaluation.objective;
+            result.schedule  = std::move(schedule);
+            best_assignment  = assigned;
+        }
+
+        if (DEBUG) {
+            std::cout << "Decomposition iteration " << result.iterations << ": master "
+                      << response.objective_value() << ", bound " << result.lower_bound
+                      << ", best " << result.objective << std::endl;
+        }
+        if (result.objective >= 0 and result.lower_bound >= result.objective) {
+            break;   // the best schedule is optimal
+        }
+        if (!seen_assignments.insert(assignment).second) {
+            break;   // the cuts did not change the assignment
+        }
+
+        // 3. sequencing subproblems, one per machine in parallel
+        std::map<MachineID, std::vector<JobID>> machine_jobs;
+        for (const auto& [job_id, machine_id] : assignment) {
+            machine_jobs[machine_id].push_back(job_id);
+        }
+        std::vector<SubproblemResult> subproblems;
+        for (const auto& [machine_id, job_ids] : machine_jobs) {
+            subproblems.push_back({machine_id, job_ids});
+        }
+        // a bounded number of concurrent solves, as for the scenarios
+        const int num_subproblems = subproblems.size();
+        const int num_slots       = std::clamp(
+            options.num_search_workers / std::max(1, options.min_subproblem_workers),
+            1,
+            num_subproblems);
+        const int num_workers = std::max(1, options.num_search_workers / num_slots);
+        const int time_limit  = std::min(options.subproblem_time_limit, remaining());
+        const auto closed_fixed_data = fix_machine_assignment(closed_data, assigned);
+
+        std::atomic<int>         next = 0;
+        std::vector<std::thread> slots;
+        for (int slot = 0; slot < num_slots; ++slot) {
+            slots.emplace_back([&] {
+                for (auto i = next++; i < num_subproblems; i = next++) {
+                    solve_subproblem(subproblems[i], closed_fixed_data, num_workers, time_limit);
+                }
+            });
+        }
+        for (auto& slot : slots) {
+            slot.join();
+        }
+
+        // 4. cuts, when the machine is worse than the master estimated
+        const int64_t master_makespan = SolutionIntegerValue(response, master.makespan);
+        for (const auto& subproblem : subproblems) {
+            const auto& tardiness_var = master.tardiness_vars.at(subproblem.machine_id);
+            std::vector<BoolVar> assigned_vars;
+            for (const auto job_id : subproblem.job_ids) {
+                assigned_vars.push_back(
+                    master.assignment_vars.at({job_id, subproblem.machine_id}));
+            }
+
+            if (subproblem.status == CpSolverStatus::INFEASIBLE) {
+                // no-good: one of the jobs leaves the machine
+                std::vector<BoolVar> literals;
+                for (const auto& var : assigned_vars) {
+                    literals.push_back(~var);
+                }
+                master.cp_model.AddBoolOr(literals);
+                result.num_no_goods++;
+                continue;
+            }
+            if (subproblem.status != CpSolverStatus::OPTIMAL and
+                subproblem.status != CpSolverStatus::FEASIBLE) {
+                continue;
+            }
+
+            const int64_t estimate =
+                master_makespan + SolutionIntegerValue(response, tardiness_var);
+            if (subproblem.bound <= estimate) {
+                continue;
+            }
+            // makespan + machine tardiness >= bound while all the jobs stay on the machine
+            LinearExpr cut = LinearExpr(master.makespan) + tardiness_var;
+            for (const auto& var : assigned_vars) {
+                cut += LinearExpr::Term(~var, subproblem.bound);
+            }
+            master.cp_model.AddGreaterOrEqual(cut, subproblem.bound);
+            result.num_cuts++;
+        }
+    }
+
+    // 5. the best assignment with the full model, started from its greedy schedule
+    if (!best_assignment.empty() and remaining() > 0 and result.lower_bound < result.objective) {
+        const auto fixed_data = fix_machine_assignment(inst_data, best_assignment);
+
+        CpModelBuilder      cp_model;
+        TaskVars            task_vars;
+        ModelIndex          model_index;
+        std::vector<IntVar> obj_exprs;
+        build_model(cp_model, task_vars, model_index, obj_exprs, fixed_data, BuildOptions());
+        add_solution_hint(cp_model, task_vars, result.schedule);
+
+        Model         model;
+        SatParameters parameters;
+        set_time_limit(parameters, remaining());
+        set_num_search_workers(parameters, options.num_search_workers);
+        disable_log_search_progress(parameters);
+        add_parameters_to_model(model, parameters);
+        const auto response = solve_model(model, cp_model);
+        if (response.status() == CpSolverStatus::OPTIMAL or
+            response.status() == CpSolverStatus::FEASIBLE) {
+            auto       schedule   = extract_schedule(response, task_vars, fixed_data);
+            const auto evaluation = evaluate_schedule(schedule, inst_data);
+            if (evaluation.feasible() and evaluation.objective < result.objective) {
+                result.objective = evaluation.objective;
+                result.schedule  = std::move(schedule);
+            }
+        }
+    }
+
+    return result;
+}
+
+void print_decomposition_result(const DecompositionResult& result)
+{
+    std::cout << "Decomposition: objective " << result.objective << ", lower bound "
+              << result.lower_bound << ", " << result.iterations << " iterations, "
+              << result.num_cuts << " optimality cuts, " << result.num_no_goods << " no-goods"
+              << std::endl;
+}
+
+}   // namespace sat
+}   // namespace operations_research
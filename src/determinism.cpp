@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <iostream>
+
+#include "ortools/sat/cp_model.h"
+#include "ortools/sat/model.h"
+#include "ortools/sat/sat_parameters.pb.h"
+
+#include "build_model.hpp"
+#include "determinism.hpp"
+#include "solve_model.hpp"
+#include "types.hpp"
+
+namespace operations_research {
+namespace sat {
+
+DeterminismReport check_determinism(const InstData& inst_data, int runs, int num_search_workers,
+                                    int random_seed, double deterministic_time_limit)
+{
+    DeterminismReport report;
+
+    BuildOptions build_options;
+    build_options.fixed_search_order = true;
+
+    CpSolverResponse reference;
+    for (int run = 0; run < runs; ++run) {
+        // rebuild the model in each run, the build must be deterministic too
+        CpModelBuilder      cp_model;
+        TaskVars            task_vars;
+        ModelIndex          model_index;
+        std::vector<IntVar> obj_exprs;
+        build_model(cp_model, task_vars, model_index, obj_exprs, inst_data, build_options);
+
+        Model         model;
+        SatParameters parameters;
+        set_num_search_workers(parameters, num_search_workers);
+        set_deterministic_mode(parameters, random_seed, deterministic_time_limit);
+        add_parameters_to_model(model, parameters);
+
+        auto response = solve_model(model, cp_model);
+
+        std::cout << "Run " << run << ": status " << CpSolverStatus_Name(response.status())
+                  << ", objective " << response.objective_value() << ", deterministic time "
+                  << response.deterministic_time() << ", wall time " << response.wall_time()
+                  << std::endl;
+
+        if (run == 0) {
+            reference                     = response;
+            report.min_deterministic_time = response.deterministic_time();
+            report.max_deterministic_time = response.deterministic_time();
+            report.min_wall_time          = response.wall_time();
+            report.max_wall_time          = response.wall_time();
+        }
+        else {
+            const bool same_solution =
+                response.status() == reference.status() and
+                response.objective_value() == reference.objective_value() and
+                std::equal(response.solution().begin(),
+                           response.solution().end(),
+                           reference.solution().begin(),
+                           reference.solution().end());
+            if (!same_solution) {
+                std::cout << "Run " << run << " differs from run 0" << std::endl;
+                report.identical = false;
+            }
+
+            report.min_deterministic_time =
+                std::min(report.min_deterministic_time, response.deterministic_time());
+            report.max_deterministic_time =
+                std::max(report.max_deterministic_time, response.deterministic_time());
+            report.min_wall_time = std::min(report.min_wall_time, response.wall_time());
+            report.max_wall_time = std::max(report.max_wall_time, response.wall_time());
+        }
+        report.runs++;
+    }
+
+    return report;
+}
+
+void print_determinism_report(const DeterminismReport& report)
+{
+    std::cout << "Runs: " << report.runs << std::endl;
+    std::cout << "Identical results: " << (report.identical ? "yes" : "no") << std::endl;
+    std::cout << "Deterministic time: [" << report.min_deterministic_time << ", "
+              << report.max_deterministic_time << "]" << std::endl;
+    std::cout << "Wall time: [" << report.min_wall_time << ", " << report.max_wall_time << "]"
+              << std::endl;
+}
+
+}   // namespace sat
+}   // namespace operations_research
@@ -0,0 +1,27 @@
+#include <iostream>
+#include <string>
+
+#include "determinism.hpp"
+#include "read_data.hpp"
+#include "types.hpp"
+
+// usage: litho_determinism [runs] [num_search_workers] [random_seed] [deterministic_time_limit]
+int main(int argc, char** argv)
+{
+    int    runs                     = argc > 1 ? std::stoi(argv[1]) : 5;
+    int    num_search_workers       = argc > 2 ? std::stoi(argv[2]) : 16;
+    int    random_seed              = argc > 3 ? std::stoi(argv[3]) : 0;
+    double deterministic_time_limit = argc > 4 ? std::stod(argv[4]) : 10.0;
+
+    auto inst_data = operations_research::sat::read_inst_data();
+    auto report    = operations_research::sat::check_determinism(
+        inst_data, runs, num_search_workers, random_seed, deterministic_time_limit);
+    operations_research::sat::print_determinism_report(report);
+
+    // the deterministic time must not move by more than 1% between the runs
+    const bool stable_time =
+        report.max_deterministic_time - report.min_deterministic_time <=
+        0.01 * report.max_deterministic_time;
+
+    return report.identical and stable_time ? 0 : 1;
+}
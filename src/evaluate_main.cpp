@@ -0,0 +1,46 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "evaluator.hpp"
+#include "read_data.hpp"
+#include "types.hpp"
+
+// usage: litho_evaluate [sol.csv] [repeats] [--campaign-usage]
+// evaluate a schedule against the instance under data folder, the repeats are only used to time
+// the evaluation
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    bool                     campaign_usage = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--campaign-usage") {
+            campaign_usage = true;
+        }
+        else {
+            args.push_back(arg);
+        }
+    }
+    std::string file_name = args.size() > 0 ? args[0] : "data/sol.csv";
+    int         repeats   = args.size() > 1 ? std::stoi(args[1]) : 1;
+
+    auto inst_data = operations_research::sat::read_inst_data();
+    if (campaign_usage) {
+        inst_data.reticle_usage_rule = operations_research::sat::ReticleUsageRule::Campaign;
+    }
+    auto schedule  = operations_research::sat::read_schedule(file_name);
+
+    operations_research::sat::Evaluation evaluation;
+    auto start_time = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; ++i) {
+        evaluation = operations_research::sat::evaluate_schedule(schedule, inst_data);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+
+    operations_research::sat::print_evaluation(evaluation);
+    std::cout << "Evaluations per second: " << repeats / elapsed.count() << std::endl;
+
+    return evaluation.feasible() ? 0 : 1;
+}
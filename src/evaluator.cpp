@@ -0,0 +1,327 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <set>
+#include <sstream>
+
+#include "calendar.hpp"
+#include "evaluator.hpp"
+#include "types.hpp"
+
+namespace operations_research {
+namespace sat {
+
+Evaluation evaluate_schedule(const Schedule& schedule, const InstData& inst_data)
+{
+    return evaluate_schedule(
+        schedule, inst_data, inst_data.job_release_times, inst_data.job_due_times);
+}
+
+Evaluation evaluate_schedule(const Schedule& full_schedule, const InstData& inst_data,
+                             const std::map<JobID, TimeStamp>& release_times,
+                             const std::map<JobID, TimeStamp>& due_times)
+{
+    Evaluation evaluation;
+
+    // 0. a job unknown to the instance (e.g. a sol.csv of another instance) is reported and left
+    // out of the other checks
+    Schedule schedule;
+    schedule.reserve(full_schedule.size());
+    for (const auto& task : full_schedule) {
+        if (!inst_data.job_reticle_pairs.contains(task.job_id) or
+            !release_times.contains(task.job_id) or !due_times.contains(task.job_id)) {
+            evaluation.violations.push_back({ViolationType::UnknownJob, task.job_id, 1});
+            continue;
+        }
+        schedule.push_back(task);
+    }
+
+    const auto  num_tasks   = schedule.size();
+    const auto& changeovers = inst_data.changeovers;
+
+    // 1. every job exactly once, on one of its candidate machines, for its processing time
+    std::set<JobID> scheduled_jobs;
+    for (const auto& task : schedule) {
+        if (!scheduled_jobs.insert(task.job_id).second) {
+            evaluation.violations.push_back({ViolationType::DuplicateJob, task.job_id, 1});
+        }
+
+        const auto ptime = inst_data.processing_times.find({task.job_id, task.machine_id});
+        if (ptime == inst_data.processing_times.end()) {
+            evaluation.violations.push_back({ViolationType::InvalidMachine, task.job_id, 1});
+        }
+        else if (static_cast<int64_t>(task.end) - task.start != ptime->second) {
+            const int64_t amount = static_cast<int64_t>(ptime->second) - (task.end - task.start);
+            evaluation.violations.push_back({ViolationType::ProcessingTime, task.job_id, amount});
+        }
+
+        const auto release = release_times.at(task.job_id);
+        if (task.start < release) {
+            const int64_t amount = static_cast<int64_t>(release) - task.start;
+            evaluation.violations.push_back({ViolationType::ReleaseTime, task.job_id, amount});
+        }
+
+        const auto downtime =
+            find_downtime_overlap(inst_data, task.machine_id, task.start, task.end);
+        if (downtime > 0) {
+            evaluation.violations.push_back(
+                {ViolationType::MachineDowntime, task.job_id, downtime});
+        }
+    }
+    for (const auto& [task_id, _] : inst_data.processing_times) {
+        if (scheduled_jobs.find(task_id.first) == scheduled_jobs.end()) {
+            evaluation.violations.push_back({ViolationType::MissingJob, task_id.first, 1});
+            scheduled_jobs.insert(task_id.first);   // report it only once
+        }
+    }
+
+    // the reticle of each task, from the instance
+    std::vector<ReticleID> reticles(num_tasks);
+    for (size_t i = 0; i < num_tasks; ++i) {
+        reticles[i] = inst_data.job_reticle_pairs.at(schedule[i].job_id);
+    }
+
+    // 2. task order on each machine and on each reticle
+    std::vector<size_t> machine_order(num_tasks);
+    std::iota(machine_order.begin(), machine_order.end(), 0);
+    std::sort(machine_order.begin(), machine_order.end(), [&](size_t i, size_t j) {
+        return std::make_pair(schedule[i].machine_id, schedule[i].start) <
+               std::make_pair(schedule[j].machine_id, schedule[j].start);
+    });
+
+    std::vector<size_t> reticle_order(num_tasks);
+    std::iota(reticle_order.begin(), reticle_order.end(), 0);
+    std::sort(reticle_order.begin(), reticle_order.end(), [&](size_t i, size_t j) {
+        return std::make_pair(reticles[i], schedule[i].start) <
+               std::make_pair(reticles[j], schedule[j].start);
+    });
+
+    // required setup / transfer before each task, and the end of its predecessors
+    std::vector<int64_t> setups(num_tasks, 0);
+    std::vector<int64_t> transfers(num_tasks, 0);
+    std::vector<int64_t> requalifications(num_tasks, 0);
+    std::vector<int64_t> ready_times(num_tasks, 0);   // max end of the predecessors
+    std::vector<bool>    reticle_first_at_init(num_tasks, false);
+    std::vector<int>     usages(num_tasks, 1);
+
+    const bool campaign = inst_data.reticle_usage_rule == ReticleUsageRule::Campaign;
+
+    // 3. reticle sequences: transfer (and setup after it) from the previous position. under the
+    // campaign rule, the count goes on along the sequence and is reset by a requalification
+    for (size_t k = 0; k < num_tasks; ++k) {
+        const auto  i    = reticle_order[k];
+        const auto& task = schedule[i];
+
+        MachineID position;
+        int       previous_usage;
+        if (k == 0 or reticles[reticle_order[k - 1]] != reticles[i]) {
+            position                 = inst_data.reticle_init_positions.at(reticles[i]);
+            reticle_first_at_init[i] = position == task.machine_id;
+            previous_usage           = inst_data.reticle_init_usage.at(reticles[i]);
+        }
+        else {
+            const auto& previous = schedule[reticle_order[k - 1]];
+            position             = previous.machine_id;
+            ready_times[i]       = previous.end;
+            previous_usage       = usages[reticle_order[k - 1]];
+            if (previous.end > task.start) {
+                evaluation.violations.push_back({ViolationType::ReticleOverlap,
+                                                 task.job_id,
+                                                 static_cast<int64_t>(previous.end) - task.start});
+            }
+        }
+
+        if (campaign) {
+            if (previous_usage >= inst_data.reticle_sharing_limits.at(reticles[i])) {
+                requalifications[i] = REQUALIFICATION_TIME;
+                usages[i]           = 1;
+            }
+            else {
+                usages[i] = previous_usage + 1;
+            }
+        }
+
+        // an invalid machine is already reported, it has no changeover costs
+        if (position != task.machine_id and changeovers.has_machine(position) and
+            changeovers.has_machine(task.machine_id)) {
+            transfers[i] = changeovers.get_transfer_time(position, task.machine_id);
+            setups[i]    = TRANSFER_SETUP_TIME;
+        }
+    }
+
+    // 4. machine sequences: setup between different reticles, reticle sharing count of the runs
+    const std::vector<int64_t> reticle_ready_times = ready_times;
+    for (size_t k = 0; k < num_tasks; ++k) {
+        const auto  i    = machine_order[k];
+        const auto& task = schedule[i];
+
+        if (k > 0 and schedule[machine_order[k - 1]].machine_id == task.machine_id) {
+            const auto  j        = machine_order[k - 1];
+            const auto& previous = schedule[j];
+            ready_times[i]       = std::max<int64_t>(ready_times[i], previous.end);
+            if (previous.end > task.start) {
+                evaluation.violations.push_back({ViolationType::MachineOverlap,
+                                                 task.job_id,
+                                                 static_cast<int64_t>(previous.end) - task.start});
+            }
+
+            if (reticles[j] != reticles[i] and changeovers.has_machine(task.machine_id)) {
+                const auto setup_time =
+                    changeovers.get_setup_time(task.machine_id, reticles[j], reticles[i]);
+                setups[i] = std::max<int64_t>(setups[i], setup_time);
+            }
+            else if (reticles[j] == reticles[i] and !campaign) {
+                usages[i] = usages[j] + 1;
+            }
+        }
+        if (campaign) {
+            continue;
+        }
+
+        if (reticle_first_at_init[i]) {
+            usages[i] = std::max(usages[i], inst_data.reticle_init_usage.at(reticles[i]) + 1);
+        }
+        const auto limit = inst_data.reticle_sharing_limits.at(reticles[i]);
+        if (usages[i] > limit) {
+            evaluation.violations.push_back(
+                {ViolationType::ReticleSharing, task.job_id, usages[i] - limit});
+        }
+    }
+
+    // 5. layer order of the lots, the previous operation of a lot is checked when it is scheduled
+    std::map<JobID, TimeStamp> job_ends;
+    for (const auto& task : schedule) {
+        job_ends[task.job_id] = task.end;
+    }
+    for (const auto& task : schedule) {
+        const auto step = inst_data.job_predecessors.find(task.job_id);
+        if (step == inst_data.job_predecessors.end()) {
+            continue;
+        }
+        const auto previous_end = job_ends.find(step->second.previous_job_id);
+        if (previous_end == job_ends.end()) {
+            continue;
+        }
+        const int64_t earliest_start =
+            static_cast<int64_t>(previous_end->second) + step->second.min_queue_time;
+        if (task.start < earliest_start) {
+            evaluation.violations.push_back(
+                {ViolationType::QueueTime, task.job_id, earliest_start - task.start});
+        }
+    }
+
+    // 6. changeover gaps and objective terms
+    for (size_t i = 0; i < num_tasks; ++i) {
+        const auto& task = schedule[i];
+
+        // the requalification is done before the transfer, the machine can go on meanwhile
+        const int64_t earliest_start =
+            std::max(ready_times[i], reticle_ready_times[i] + requalifications[i]) + setups[i] +
+            transfers[i];
+        if (task.start < earliest_start) {
+            evaluation.violations.push_back(
+                {ViolationType::Changeover, task.job_id, earliest_start - task.start});
+        }
+
+        evaluation.total_setup += setups[i];
+        evaluation.total_transfer += transfers[i];
+        evaluation.num_setups += setups[i] > 0 ? 1 : 0;
+        evaluation.num_transfers += transfers[i] > 0 ? 1 : 0;
+        evaluation.num_requalifications += requalifications[i] > 0 ? 1 : 0;
+
+        const int64_t due_time = due_times.at(task.job_id);
+        evaluation.makespan    = std::max<int64_t>(evaluation.makespan, task.end);
+        evaluation.total_tardiness += std::max<int64_t>(0, task.end - due_time);
+    }
+    evaluation.objective = evaluation.makespan + evaluation.total_tardiness;
+
+    return evaluation;
+}
+
+Schedule read_schedule(const std::string& file_name)
+{
+    Schedule      schedule;
+    std::ifstream sol_file;
+    sol_file.open(file_name);
+    if (!sol_file.is_open()) {
+        std::cerr << "Unable to open " << file_name << " file" << std::endl;
+        return schedule;
+    }
+
+    std::string line;
+    std::getline(sol_file, line);   // skip the header
+    while (std::getline(sol_file, line)) {
+        std::stringstream        line_stream(line);
+        std::string              cell;
+        std::vector<std::string> row;
+        while (std::getline(line_stream, cell, ',')) {
+            row.push_back(cell);
+        }
+        if (row.size() < 10) {
+            std::cerr << "Invalid data format in " << file_name << " file" << std::endl;
+            continue;
+        }
+        try {
+            ScheduledTask task;
+            task.job_id        = std::stoi(row[0]);
+            task.machine_id    = std::stoi(row[1]);
+            task.reticle_id    = std::stoi(row[2]);
+            task.transfer      = std::stoi(row[3]);
+            task.setup         = std::stoi(row[4]);
+            task.start         = std::stoi(row[5]);
+            task.processing    = std::stoi(row[6]);
+            task.end           = std::stoi(row[7]);
+            task.position      = std::stoi(row[8]);
+            task.reticle_usage = std::stoi(row[9]);
+            schedule.push_back(task);
+        }
+        catch (const std::invalid_argument& ia) {
+            std::cerr << "Invalid data in " << file_name << " file: " << ia.what() << std::endl;
+        }
+    }
+
+    sol_file.close();   // Close the file
+
+    return schedule;
+}
+
+const char* violation_name(ViolationType type)
+{
+    switch (type) {
+    case ViolationType::MissingJob: return "missing job";
+    case ViolationType::DuplicateJob: return "duplicate job";
+    case ViolationType::InvalidMachine: return "invalid machine";
+    case ViolationType::ProcessingTime: return "processing time";
+    case ViolationType::ReleaseTime: return "release time";
+    case ViolationType::MachineOverlap: return "machine overlap";
+    case ViolationType::ReticleOverlap: return "reticle overlap";
+    case ViolationType::Changeover: return "setup / transfer";
+    case ViolationType::ReticleSharing: return "reticle sharing";
+    case ViolationType::MachineDowntime: return "machine downtime";
+    case ViolationType::QueueTime: return "queue time";
+    case ViolationType::UnknownJob: return "unknown job";
+    default: return "undefined";
+    }
+}
+
+void print_evaluation(const Evaluation& evaluation)
+{
+    std::cout << "Objective: " << evaluation.objective << std::endl;
+    std::cout << "Makespan: " << evaluation.makespan << std::endl;
+    std::cout << "Total tardiness: " << evaluation.total_tardiness << std::endl;
+    std::cout << "Total setup time: " << evaluation.total_setup << " (" << evaluation.num_setups
+              << " setups)" << std::endl;
+    std::cout << "Total transfer time: " << evaluation.total_transfer << " ("
+              << evaluation.num_transfers << " transfers)" << std::endl;
+    std::cout << "Reticle requalifications: " << evaluation.num_requalifications << std::endl;
+    std::cout << "Violations: " << evaluation.violations.size() << std::endl;
+    for (const auto& violation : evaluation.violations) {
+        std::cout << "  Job " << violation.job_id << ": " << violation_name(violation.type)
+                  << " (" << violation.amount << ")" << std::endl;
+    }
+}
+
+}   // namespace sat
+}   // namespace operations_research
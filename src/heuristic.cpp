@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <iostream>
+#include <set>
+
+#include "calendar.hpp"
+#include "heuristic.hpp"
+#include "types.hpp"
+
+namespace operations_research {
+namespace sat {
+constexpr bool DEBUG = true;
+
+constexpr std::size_t DISPATCH_WINDOW = 16;   // jobs compared at each step of dispatch_schedule
+
+DispatchState::DispatchState(const InstData& inst_data)
+    : inst_data_(&inst_data)
+{
+    for (const auto& [task_id, _] : inst_data.processing_times) {
+        machine_states_[task_id.second] = MachineState();
+    }
+    for (const auto& [reticle_id, machine_id] : inst_data.reticle_init_positions) {
+        reticle_states_[reticle_id].position = machine_id;
+    }
+    for (const auto& [reticle_id, usage] : inst_data.reticle_init_usage) {
+        reticle_states_[reticle_id].usage = usage;
+    }
+    // only the previous layers are tracked, to keep the state small to copy
+    for (const auto& [_, step] : inst_data.job_predecessors) {
+        job_ends_[step.previous_job_id] = std::nullopt;
+    }
+}
+
+bool DispatchState::next_task(JobID job_id, MachineID machine_id, ScheduledTask& task) const
+{
+    const auto  reticle_id = inst_data_->job_reticle_pairs.at(job_id);
+    const auto  duration   = inst_data_->processing_times.at({job_id, machine_id});
+    const auto& machine    = machine_states_.at(machine_id);
+    const auto& reticle    = reticle_states_.at(reticle_id);
+
+    // after the previous layer of the lot and its queue time
+    TimeStamp  route_ready = 0;
+    const auto step        = inst_data_->job_predecessors.find(job_id);
+    if (step != inst_data_->job_predecessors.end()) {
+        const auto previous_end = job_ends_.find(step->second.previous_job_id);
+        if (previous_end == job_ends_.end() or !previous_end->second) {
+            return false;
+        }
+        route_ready = *previous_end->second + step->second.min_queue_time;
+    }
+
+    // transfer from the current position of the reticle, then setup
+    TimeDuration transfer = 0;
+    TimeDuration setup    = 0;
+    if (reticle.position != machine_id) {
+        transfer = inst_data_->changeovers.get_transfer_time(reticle.position, machine_id);
+        setup    = TRANSFER_SETUP_TIME;
+    }
+
+    // setup from the previous reticle on the machine
+    if (machine.used and machine.last_reticle != reticle_id) {
+        const auto setup_time =
+            inst_data_->changeovers.get_setup_time(machine_id, machine.last_reticle, reticle_id);
+        setup = std::max(setup, setup_time);
+    }
+
+    // reticle sharing count
+    const auto   limit           = inst_data_->reticle_sharing_limits.at(reticle_id);
+    int          usage           = 1;
+    TimeDuration requalification = 0;
+    if (inst_data_->reticle_usage_rule == ReticleUsageRule::Campaign) {
+        if (reticle.usage >= limit) {
+            requalification = REQUALIFICATION_TIME;
+        }
+        else {
+            usage = reticle.usage + 1;
+        }
+    }
+    else {
+        if (machine.used and machine.last_reticle == reticle_id) {
+            usage = machine.last_usage + 1;
+        }
+        if (!reticle.used and reticle.position == machine_id) {
+            usage = std::max(usage, inst_data_->reticle_init_usage.at(reticle_id) + 1);
+        }
+        if (usage > limit) {
+            return false;
+        }
+    }
+
+    const TimeStamp ready = std::max({inst_data_->job_release_times.at(job_id),
+                                      route_ready,
+                                      machine.available + setup + transfer,
+                                      reticle.available + requalification + setup + transfer});
+    const TimeStamp start = find_available_start(*inst_data_, machine_id, ready, duration);
+
+    task = {job_id,
+            machine_id,
+            reticle_id,
+            transfer,
+            setup,
+            start,
+            duration,
+            start + duration,
+            machine.task_count,
+            usage};
+    return true;
+}
+
+void DispatchState::append(const ScheduledTask& task)
+{
+    auto& machine        = machine_states_.at(task.machine_id);
+    machine.used         = true;
+    machine.available    = task.end;
+    machine.last_reticle = task.reticle_id;
+    machine.last_usage   = task.reticle_usage;
+    machine.task_count++;
+
+    auto& reticle     = reticle_states_.at(task.reticle_id);
+    reticle.used      = true;
+    reticle.available = task.end;
+    reticle.position  = task.machine_id;
+    reticle.usage     = task.reticle_usage;
+
+    const auto job_end = job_ends_.find(task.job_id);
+    if (job_end != job_ends_.end()) {
+        job_end->second = task.end;
+    }
+}
+
+Schedule greedy_schedule(const InstData& inst_data)
+{
+    // candidate machines of each job
+    std::map<JobID, std::vector<MachineID>> job_machines;
+    for (const auto& [task_id, _] : inst_data.processing_times) {
+        const auto [job_id, machine_id] = task_id;
+        job_machines[job_id].push_back(machine_id);
+    }
+
+    // EDD order, used to break the ties
+    std::vector<JobID> pending_jobs;
+    for (const auto& [job_id, _] : job_machines) {
+        pending_jobs.push_back(job_id);
+    }
+    std::sort(pending_jobs.begin(), pending_jobs.end(), [&](JobID job1, JobID job2) {
+        return std::make_tuple(inst_data.job_due_times.at(job1),
+                               inst_data.job_release_times.at(job1),
+                               job1) < std::make_tuple(inst_data.job_due_times.at(job2),
+                                                       inst_data.job_release_times.at(job2),
+                                                       job2);
+    });
+
+    DispatchState state(inst_data);
+    Schedule      schedule;
+
+    // list scheduling: dispatch the job that can end first. a job blocked by the sharing limit of
+    // its reticle waits until another job breaks the run, a later layer waits for the previous one
+    while (!pending_jobs.empty()) {
+        bool          found = false;
+        size_t        best_index;
+        ScheduledTask best;
+        for (size_t index = 0; index < pending_jobs.size(); ++index) {
+            for (const auto machine_id : job_machines.at(pending_jobs[index])) {
+                ScheduledTask task;
+                if (!state.next_task(pending_jobs[index], machine_id, task)) {
+                    continue;
+                }
+                // on the same end time, prefer the shorter setup + transfer
+                if (!found or task.end < best.end or
+                    (task.end == best.end and
+                     task.setup + task.transfer < best.setup + best.transfer)) {
+                    found      = true;
+                    best_index = index;
+                    best       = task;
+                }
+            }
+        }
+        if (!found) {
+            break;
+        }
+
+        state.append(best);
+        schedule.push_back(best);
+        pending_jobs.erase(pending_jobs.begin() + best_index);
+    }
+
+    if (DEBUG) {
+        std::cout << "Greedy schedule: " << schedule.size() << " jobs placed, "
+                  << pending_jobs.size() << " jobs not placed" << std::endl;
+    }
+
+    return schedule;
+}
+
+Schedule dispatch_schedule(const InstData& inst_data)
+{
+    std::map<JobID, std::vector<MachineID>> job_machines;
+    for (const auto& [task_id, _] : inst_data.processing_times) {
+        const auto [job_id, machine_id] = task_id;
+        job_machines[job_id].push_back(machine_id);
+    }
+
+    std::vector<JobID> jobs;
+    for (const auto& [job_id, _] : job_machines) {
+        jobs.push_back(job_id);
+    }
+    std::sort(jobs.begin(), jobs.end(), [&](JobID job1, JobID job2) {
+        return std::make_tuple(inst_data.job_release_times.at(job1),
+                               inst_data.job_due_times.at(job1),
+                               job1) < std::make_tuple(inst_data.job_release_times.at(job2),
+                                                       inst_data.job_due_times.at(job2),
+                                                       job2);
+    });
+
+    DispatchState                       state(inst_data);
+    Schedule                            schedule;
+    std::set<JobID>                     done;      // placed or given up
+    std::map<JobID, std::vector<JobID>> waiting;   // later layers by the previous layer
+    std::vector<JobID>                  window;    // next jobs in release order
+    std::size_t                         next = 0;
+
+    auto finish = [&](std::size_t index) {
+        const auto job_id = window[index];
+        window.erase(window.begin() + index);
+        done.insert(job_id);
+        // the later layers of the lot are ready now
+        const auto next_layers = waiting.find(job_id);
+        if (next_layers != waiting.end()) {
+            window.insert(window.end(), next_layers->second.begin(), next_layers->second.end());
+            waiting.erase(next_layers);
+        }
+    };
+
+    while (true) {
+        // a later layer waits for its previous layer, unless that one is already done
+        while (window.size() < DISPATCH_WINDOW and next < jobs.size()) {
+            const auto job_id = jobs[next++];
+            const auto step   = inst_data.job_predecessors.find(job_id);
+            if (step != inst_data.job_predecessors.end() and
+                !done.contains(step->second.previous_job_id)) {
+                waiting[step->second.previous_job_id].push_back(job_id);
+                continue;
+            }
+            window.push_back(job_id);
+        }
+        if (window.empty()) {
+            break;
+        }
+
+        // the job of the window that can end first, as in greedy_schedule
+        bool          found = false;
+        std::size_t   best_index;
+        ScheduledTask best;
+        for (std::size_t index = 0; index < window.size(); ++index) {
+            for (const auto machine_id : job_machines.at(window[index])) {
+                ScheduledTask task;
+                if (!state.next_task(window[index], machine_id, task)) {
+                    continue;
+                }
+                if (!found or task.end < best.end or
+                    (task.end == best.end and
+                     task.setup + task.transfer < best.setup + best.transfer)) {
+                    found      = true;
+                    best_index = index;
+                    best       = task;
+                }
+            }
+        }
+
+        // none of the window can be placed, the oldest job is given up
+        if (!found) {
+            finish(0);
+            continue;
+        }
+        state.append(best);
+        schedule.push_back(best);
+        finish(best_index);
+    }
+
+    if (DEBUG) {
+        std::cout << "Dispatch schedule: " << schedule.size() << " jobs placed, "
+                  << jobs.size() - schedule.size() << " jobs not placed" << std::endl;
+    }
+
+    return schedule;
+}
+
+}   // namespace sat
+}   // namespace operations_research
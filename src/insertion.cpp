@@ -0,0 +1,406 @@
+#include <algorithm>
+#include <iostream>
+#include <limits>
+
+#include "calendar.hpp"
+#include "insertion.hpp"
+#include "types.hpp"
+
+namespace operations_research {
+namespace sat {
+constexpr bool DEBUG = true;
+
+namespace {
+
+constexpr int64_t NO_LIMIT   = std::numeric_limits<int64_t>::max() / 4;
+constexpr int64_t NOT_INSERTABLE = std::numeric_limits<int64_t>::max();
+
+const std::vector<int> NO_TASKS;
+
+// the per-position data needed to build the inserted task, not used by the scoring
+struct Candidate
+{
+    MachineID    machine_id;
+    TimeDuration duration;
+    TimeDuration transfer;
+    TimeDuration setup;
+    int          position;
+    int          usage;
+};
+
+}   // namespace
+
+InsertionEngine::InsertionEngine(const Schedule& schedule, const InstData& inst_data)
+    : schedule_(&schedule)
+    , inst_data_(&inst_data)
+    , states_(schedule.size())
+{
+    const auto& changeovers = inst_data.changeovers;
+
+    for (int i = 0; i < static_cast<int>(schedule.size()); ++i) {
+        machine_sequences_[schedule[i].machine_id].push_back(i);
+        reticle_sequences_[schedule[i].reticle_id].push_back(i);
+        makespan_ = std::max<int64_t>(makespan_, schedule[i].end);
+    }
+    auto by_start = [&](int i, int j) { return schedule[i].start < schedule[j].start; };
+    for (auto& [_, sequence] : machine_sequences_) {
+        std::sort(sequence.begin(), sequence.end(), by_start);
+    }
+    for (auto& [_, sequence] : reticle_sequences_) {
+        std::sort(sequence.begin(), sequence.end(), by_start);
+    }
+
+    // reticle sequences: transfer from the previous position, as in evaluate_schedule
+    std::vector<bool> first_at_init(schedule.size(), false);
+    for (const auto& [reticle_id, sequence] : reticle_sequences_) {
+        const auto init     = inst_data.reticle_init_positions.find(reticle_id);
+        MachineID  position = init != inst_data.reticle_init_positions.end()
+                                  ? init->second
+                                  : schedule[sequence.front()].machine_id;
+        first_at_init[sequence.front()] = position == schedule[sequence.front()].machine_id;
+
+        for (std::size_t k = 0; k < sequence.size(); ++k) {
+            const auto& task  = schedule[sequence[k]];
+            auto&       state = states_[sequence[k]];
+            if (k > 0) {
+                const auto& previous = schedule[sequence[k - 1]];
+                position             = previous.machine_id;
+                state.reticle_ready  = previous.end;
+            }
+            if (position != task.machine_id and changeovers.has_machine(position) and
+                changeovers.has_machine(task.machine_id)) {
+                state.moved    = true;
+                state.transfer = changeovers.get_transfer_time(position, task.machine_id);
+            }
+        }
+    }
+
+    // machine sequences: setup between different reticles, sharing count of the runs
+    for (const auto& [machine_id, sequence] : machine_sequences_) {
+        for (std::size_t k = 0; k < sequence.size(); ++k) {
+            const auto& task  = schedule[sequence[k]];
+            auto&       state = states_[sequence[k]];
+            if (k > 0) {
+                const auto& previous = schedule[sequence[k - 1]];
+                state.machine_ready  = previous.end;
+                if (previous.reticle_id == task.reticle_id) {
+                    state.usage = states_[sequence[k - 1]].usage + 1;
+                }
+                else if (changeovers.has_machine(machine_id)) {
+                    state.machine_setup = changeovers.get_setup_time(
+                        machine_id, previous.reticle_id, task.reticle_id);
+                }
+            }
+            if (first_at_init[sequence[k]]) {
+                state.usage =
+                    std::max(state.usage, inst_data.reticle_init_usage.at(task.reticle_id) + 1);
+            }
+        }
+        for (std::size_t k = sequence.size(); k-- > 0;) {
+            auto& state     = states_[sequence[k]];
+            state.run_usage = state.usage;
+            if (k + 1 < sequence.size() and
+                schedule[sequence[k + 1]].reticle_id == schedule[sequence[k]].reticle_id) {
+                state.run_usage = states_[sequence[k + 1]].run_usage;
+            }
+        }
+    }
+}
+
+TimeStamp InsertionEngine::find_start(MachineID machine_id, int64_t ready,
+                                      TimeDuration duration) const
+{
+    const auto it = inst_data_->machine_downtimes.find(machine_id);
+    if (it == inst_data_->machine_downtimes.end() or it->second.empty()) {
+        return ready;
+    }
+    return find_available_start(*inst_data_, machine_id, ready, duration);
+}
+
+Insertion InsertionEngine::find_best_insertion(const HotLot& lot) const
+{
+    const auto& schedule    = *schedule_;
+    const auto& changeovers = inst_data_->changeovers;
+    const auto  reticle_id  = lot.reticle_id;
+
+    // the lot comes from the caller, a reticle unknown to the instance has no position
+    const auto limit_it = inst_data_->reticle_sharing_limits.find(reticle_id);
+    const auto usage_it = inst_data_->reticle_init_usage.find(reticle_id);
+    if (limit_it == inst_data_->reticle_sharing_limits.end() or
+        usage_it == inst_data_->reticle_init_usage.end() or !changeovers.has_reticle(reticle_id)) {
+        return Insertion();
+    }
+    const int limit      = limit_it->second;
+    const int init_usage = usage_it->second;
+
+    const auto  reticle_it       = reticle_sequences_.find(reticle_id);
+    const auto& reticle_sequence =
+        reticle_it != reticle_sequences_.end() ? reticle_it->second : NO_TASKS;
+    const auto init = inst_data_->reticle_init_positions.find(reticle_id);
+
+    // the positions in a structure of arrays, scored in a batch below
+    std::vector<Candidate> candidates;
+    std::vector<int64_t>   readies;
+    std::vector<int64_t>   latest_ends;   // the successors keep time for their changeovers
+
+    for (const auto& [machine_id, duration] : lot.processing_times) {
+        if (!changeovers.has_machine(machine_id)) {
+            continue;
+        }
+        const auto  machine_it       = machine_sequences_.find(machine_id);
+        const auto& machine_sequence =
+            machine_it != machine_sequences_.end() ? machine_it->second : NO_TASKS;
+        const int num_machine_tasks = machine_sequence.size();
+        const int num_reticle_tasks = reticle_sequence.size();
+
+        // a position on the machine and on the reticle, gap k is before the k-th task
+        auto add_position = [&](int k, int g) {
+            const int prev         = k > 0 ? machine_sequence[k - 1] : -1;
+            const int next         = k < num_machine_tasks ? machine_sequence[k] : -1;
+            const int reticle_prev = g > 0 ? reticle_sequence[g - 1] : -1;
+            const int reticle_next = g < num_reticle_tasks ? reticle_sequence[g] : -1;
+
+            // setup after the machine predecessor, transfer from the reticle predecessor
+            int64_t machine_setup = 0;
+            int     usage         = 1;
+            if (prev >= 0 and schedule[prev].reticle_id != reticle_id) {
+                machine_setup =
+                    changeovers.get_setup_time(machine_id, schedule[prev].reticle_id, reticle_id);
+            }
+            else if (prev >= 0) {
+                usage = states_[prev].usage + 1;
+            }
+            MachineID position = machine_id;
+            if (reticle_prev >= 0) {
+                position = schedule[reticle_prev].machine_id;
+            }
+            else if (init != inst_data_->reticle_init_positions.end()) {
+                position = init->second;
+            }
+            const bool moved = position != machine_id and changeovers.has_machine(position);
+            const int64_t transfer =
+                moved ? changeovers.get_transfer_time(position, machine_id) : 0;
+            if (reticle_prev < 0 and position == machine_id) {
+                usage = std::max(usage, init_usage + 1);
+            }
+
+            // sharing limit of the job, and of the run it extends on the machine
+            if (usage > limit) {
+                return;
+            }
+            if (next >= 0 and schedule[next].reticle_id == reticle_id and
+                usage + 1 + states_[next].run_usage - states_[next].usage > limit) {
+                return;
+            }
+
+            const int64_t setup = std::max<int64_t>(moved ? TRANSFER_SETUP_TIME : 0, machine_setup);
+            const int64_t prev_end = prev >= 0 ? schedule[prev].end : 0;
+            const int64_t reticle_prev_end = reticle_prev >= 0 ? schedule[reticle_prev].end : 0;
+            const int64_t ready = std::max<int64_t>(
+                lot.release_time, std::max(prev_end, reticle_prev_end) + setup + transfer);
+
+            // the machine successor sets up from the reticle of the job, the reticle successor
+            // is transferred from the machine
+            int64_t latest_end = NO_LIMIT;
+            if (next >= 0) {
+                const auto& next_task  = schedule[next];
+                const auto& next_state = states_[next];
+                if (next == reticle_next) {
+                    latest_end = next_task.start;   // same machine and reticle, no changeover
+                }
+                else {
+                    int64_t next_setup = 0;
+                    if (next_task.reticle_id != reticle_id) {
+                        next_setup = changeovers.get_setup_time(
+                            machine_id, reticle_id, next_task.reticle_id);
+                    }
+                    const int64_t changeover =
+                        std::max<int64_t>(next_state.moved ? TRANSFER_SETUP_TIME : 0, next_setup) +
+                        next_state.transfer;
+                    if (next_state.reticle_ready + changeover > next_task.start) {
+                        return;
+                    }
+                    latest_end = next_task.start - changeover;
+                }
+            }
+            if (reticle_next >= 0 and reticle_next != next) {
+                const auto& next_task  = schedule[reticle_next];
+                const auto& next_state = states_[reticle_next];
+                const bool  next_moved = next_task.machine_id != machine_id;
+                const int64_t next_transfer =
+                    next_moved ? changeovers.get_transfer_time(machine_id, next_task.machine_id)
+                               : 0;
+                const int64_t changeover = std::max<int64_t>(next_moved ? TRANSFER_SETUP_TIME : 0,
+                                                             next_state.machine_setup) +
+                                           next_transfer;
+                if (next_state.machine_ready + changeover > next_task.start) {
+                    return;
+                }
+                latest_end = std::min<int64_t>(latest_end, next_task.start - changeover);
+            }
+            if (ready + duration > latest_end) {
+                return;
+            }
+
+            candidates.push_back({machine_id,
+                                  duration,
+                                  static_cast<TimeDuration>(transfer),
+                                  static_cast<TimeDuration>(setup),
+                                  k,
+                                  usage});
+            readies.push_back(ready);
+            latest_ends.push_back(latest_end);
+        };
+
+        // merge the gaps of the machine and of the reticle, only the overlapping ones can hold
+        // the job
+        int k = 0, g = 0;
+        while (k <= num_machine_tasks and g <= num_reticle_tasks) {
+            const int64_t machine_lo = k > 0 ? schedule[machine_sequence[k - 1]].end : 0;
+            const int64_t machine_hi =
+                k < num_machine_tasks ? schedule[machine_sequence[k]].start : NO_LIMIT;
+            const int64_t reticle_lo = g > 0 ? schedule[reticle_sequence[g - 1]].end : 0;
+            const int64_t reticle_hi =
+                g < num_reticle_tasks ? schedule[reticle_sequence[g]].start : NO_LIMIT;
+            if (std::max(machine_lo, reticle_lo) < std::min(machine_hi, reticle_hi)) {
+                add_position(k, g);
+            }
+            if (machine_hi < reticle_hi) {
+                ++k;
+            }
+            else if (reticle_hi < machine_hi) {
+                ++g;
+            }
+            else {
+                ++k;
+                ++g;
+            }
+        }
+    }
+
+    // batch scoring: the starts outside of the downtimes, then plain loops over the arrays
+    const auto           num_candidates = candidates.size();
+    std::vector<int64_t> ends(num_candidates);
+    std::vector<int64_t> scores(num_candidates);
+    for (std::size_t c = 0; c < num_candidates; ++c) {
+        ends[c] = find_start(candidates[c].machine_id, readies[c], candidates[c].duration);
+    }
+    for (std::size_t c = 0; c < num_candidates; ++c) {
+        ends[c] += candidates[c].duration;
+    }
+    const int64_t makespan = makespan_;
+    const int64_t due_time = lot.due_time;
+    for (std::size_t c = 0; c < num_candidates; ++c) {
+        const int64_t delta = std::max<int64_t>(0, ends[c] - makespan) +
+                              std::max<int64_t>(0, ends[c] - due_time);
+        scores[c]           = ends[c] <= latest_ends[c] ? delta : NOT_INSERTABLE;
+    }
+
+    Insertion insertion;
+    insertion.num_candidates = num_candidates;
+    std::size_t best         = num_candidates;
+    for (std::size_t c = 0; c < num_candidates; ++c) {
+        if (scores[c] != NOT_INSERTABLE and
+            (best == num_candidates or scores[c] < scores[best] or
+             (scores[c] == scores[best] and ends[c] < ends[best]))) {
+            best = c;
+        }
+    }
+    if (best == num_candidates) {
+        return insertion;
+    }
+
+    const auto& candidate     = candidates[best];
+    insertion.found           = true;
+    insertion.objective_delta = scores[best];
+    insertion.task            = {lot.job_id,
+                                 candidate.machine_id,
+                                 reticle_id,
+                                 candidate.transfer,
+                                 candidate.setup,
+                                 static_cast<TimeStamp>(ends[best] - candidate.duration),
+                                 candidate.duration,
+                                 static_cast<TimeStamp>(ends[best]),
+                                 candidate.position,
+                                 candidate.usage};
+
+    if (DEBUG) {
+        std::cout << "Insertion of job " << lot.job_id << ": " << num_candidates
+                  << " positions, machine " << candidate.machine_id << ", start "
+                  << insertion.task.start << ", objective delta " << insertion.objective_delta
+                  << std::endl;
+    }
+    return insertion;
+}
+
+Schedule InsertionEngine::apply(const Insertion& insertion) const
+{
+    Schedule schedule = *schedule_;
+    if (!insertion.found) {
+        return schedule;
+    }
+    const auto& task        = insertion.task;
+    const auto& changeovers = inst_data_->changeovers;
+
+    // the machine successors move one position, the successor sets up from the job, and the
+    // sharing counts of the run after the job are renumbered
+    const auto  machine_it       = machine_sequences_.find(task.machine_id);
+    const auto& machine_sequence =
+        machine_it != machine_sequences_.end() ? machine_it->second : NO_TASKS;
+    for (std::size_t k = task.position; k < machine_sequence.size(); ++k) {
+        schedule[machine_sequence[k]].position = k + 1;
+    }
+    if (task.position < static_cast<int>(machine_sequence.size())) {
+        const int   next       = machine_sequence[task.position];
+        const auto& next_state = states_[next];
+        auto&       next_task  = schedule[next];
+        if (next_task.reticle_id != task.reticle_id) {
+            const auto next_setup =
+                changeovers.get_setup_time(task.machine_id, task.reticle_id, next_task.reticle_id);
+            next_task.setup =
+                std::max<TimeDuration>(next_state.moved ? TRANSFER_SETUP_TIME : 0, next_setup);
+        }
+
+        // the run of the job goes on, or the job breaks the run of the successor
+        const bool joins_run  = next_task.reticle_id == task.reticle_id;
+        const bool breaks_run = task.position > 0 and
+                                schedule[machine_sequence[task.position - 1]].reticle_id ==
+                                    next_task.reticle_id;
+        if (joins_run or breaks_run) {
+            int usage = joins_run ? task.reticle_usage : 0;
+            for (std::size_t k = task.position; k < machine_sequence.size(); ++k) {
+                auto& run_task = schedule[machine_sequence[k]];
+                if (run_task.reticle_id != next_task.reticle_id) {
+                    break;
+                }
+                run_task.reticle_usage = ++usage;
+            }
+        }
+    }
+
+    // the reticle successor is transferred from the machine of the job
+    const auto  reticle_it       = reticle_sequences_.find(task.reticle_id);
+    const auto& reticle_sequence =
+        reticle_it != reticle_sequences_.end() ? reticle_it->second : NO_TASKS;
+    const auto next_it =
+        std::find_if(reticle_sequence.begin(), reticle_sequence.end(),
+                     [&](int i) { return (*schedule_)[i].start > task.start; });
+    if (next_it != reticle_sequence.end()) {
+        auto&      next_task = schedule[*next_it];
+        const bool moved     = next_task.machine_id != task.machine_id;
+        next_task.transfer =
+            moved ? changeovers.get_transfer_time(task.machine_id, next_task.machine_id) : 0;
+        next_task.setup = std::max<TimeDuration>(moved ? TRANSFER_SETUP_TIME : 0,
+                                                 states_[*next_it].machine_setup);
+        if (next_task.machine_id == task.machine_id and
+            next_task.position == task.position + 1) {
+            next_task.setup = 0;   // right after the job, same reticle
+        }
+    }
+
+    schedule.push_back(task);
+    return schedule;
+}
+
+}   // namespace sat
+}   // namespace operations_research
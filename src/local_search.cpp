@@ -0,0 +1,612 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <thread>
+
+#include "evaluator.hpp"
+#include "heuristic.hpp"
+#include "local_search.hpp"
+#include "types.hpp"
+
+namespace operations_research {
+namespace sat {
+constexpr bool DEBUG = true;
+
+namespace {
+
+constexpr int64_t UNPLACED_PENALTY = 1000000;   // objective penalty of a job the decode can't place
+constexpr int     CHECKPOINT_INTERVAL = 32;   // decode steps between two saved dispatch states
+
+enum class MoveType
+{
+    Insert,   // move a job to a position on one of its machines
+    Swap,     // exchange two jobs of the same machine
+};
+
+struct Move
+{
+    MoveType type;
+    int      from_machine;
+    int      from_position;
+    int      to_machine;
+    int      to_position;   // for Insert: position after the removal
+};
+
+// the decoded steps [from_step, end_step) and the checkpoints [from_step / CHECKPOINT_INTERVAL + 1,
+// checkpoint_end) changed by a move, tasks and checkpoints hold the ones they replaced
+struct Undo
+{
+    int                                           from_step;
+    int                                           end_step       = 0;
+    int                                           checkpoint_end = 0;
+    std::vector<std::pair<int, std::vector<int>>> sequences;   // (machine, sequence before)
+    Schedule                                      tasks;
+    std::vector<DispatchState>                    checkpoints;
+    int64_t                                       objective;
+};
+
+// machine sequences of the jobs (dense indices) and their decoded schedule. job_steps[j] is the
+// index in decoded of the task of job j, used to restart the decode after a move. the dispatch
+// state is saved every CHECKPOINT_INTERVAL steps: a move is decoded from the first step it can
+// change until, at a checkpoint, the state and the remaining sequences are the same as before.
+// the later steps are kept, so a move costs the steps it changes (rounded up to a checkpoint).
+// in a dense schedule a shift often runs to the end, then it costs the tail as before. the
+// makespan is a max tree over the steps, the tardiness a sum
+class SequenceSearch
+{
+public:
+    SequenceSearch(const Schedule& schedule, const InstData& inst_data)
+        : inst_data_(inst_data)
+    {
+        std::map<JobID, int>     job_index;
+        std::map<MachineID, int> machine_index;
+        for (const auto& [task_id, _] : inst_data.processing_times) {
+            const auto [job_id, machine_id] = task_id;
+            if (!job_index.contains(job_id)) {
+                job_index[job_id] = jobs_.size();
+                jobs_.push_back(job_id);
+                job_machines_.emplace_back();
+            }
+            if (!machine_index.contains(machine_id)) {
+                machine_index[machine_id] = machines_.size();
+                machines_.push_back(machine_id);
+            }
+            job_machines_[job_index.at(job_id)].push_back(machine_index.at(machine_id));
+        }
+        machine_index_ = machine_index;
+
+        std::map<ReticleID, std::vector<int>> reticle_jobs;
+        for (size_t job = 0; job < jobs_.size(); ++job) {
+            reticle_jobs[inst_data.job_reticle_pairs.at(jobs_[job])].push_back(job);
+        }
+        reticle_mates_.resize(jobs_.size());
+        for (const auto& [_, mates] : reticle_jobs) {
+            for (const auto job : mates) {
+                for (const auto mate : mates) {
+                    if (mate != job) {
+                        reticle_mates_[job].push_back(mate);
+                    }
+                }
+            }
+        }
+
+        // start sequences: order of the start times on each machine, the missing jobs at the end
+        // of their first machine
+        Schedule sorted = schedule;
+        std::sort(sorted.begin(), sorted.end(), [](const auto& task1, const auto& task2) {
+            return task1.start < task2.start;
+        });
+        sequences_.resize(machines_.size());
+        job_machine_.assign(jobs_.size(), -1);
+        for (const auto& task : sorted) {
+            const auto job = job_index.at(task.job_id);
+            if (job_machine_[job] >= 0 or !machine_index.contains(task.machine_id)) {
+                continue;
+            }
+            job_machine_[job] = machine_index.at(task.machine_id);
+            sequences_[job_machine_[job]].push_back(job);
+        }
+        for (size_t job = 0; job < jobs_.size(); ++job) {
+            if (job_machine_[job] < 0) {
+                job_machine_[job] = job_machines_[job].front();
+                sequences_[job_machine_[job]].push_back(job);
+            }
+        }
+
+        for (const auto job_id : jobs_) {
+            due_times_.push_back(inst_data.job_due_times.at(job_id));
+        }
+        job_steps_.assign(jobs_.size(), -1);
+        end_tree_.assign(2 * jobs_.size(), 0);
+        checkpoints_.emplace_back(inst_data);
+        Undo undo;
+        undo.from_step = 0;
+        decode(undo);
+    }
+
+    int64_t         objective() const { return objective_; }
+    bool            feasible() const { return decoded_.size() == jobs_.size(); }
+    const Schedule& decoded() const { return decoded_; }
+    int             num_jobs() const { return jobs_.size(); }
+
+    int job_at(int machine, int position) const { return sequences_[machine][position]; }
+
+    bool random_move(std::mt19937_64& rng, Move& move) const
+    {
+        const int job  = std::uniform_int_distribution<int>(0, jobs_.size() - 1)(rng);
+        const int kind = std::uniform_int_distribution<int>(0, 9)(rng);
+
+        move.from_machine  = job_machine_[job];
+        move.from_position = position_of(job);
+
+        if (kind < 4) {   // reassign / insert anywhere on a candidate machine
+            const auto& candidates = job_machines_[job];
+            move.type       = MoveType::Insert;
+            move.to_machine = candidates[std::uniform_int_distribution<size_t>(
+                0, candidates.size() - 1)(rng)];
+            int length      = sequences_[move.to_machine].size();
+            if (move.to_machine == move.from_machine) {
+                length--;
+            }
+            move.to_position = std::uniform_int_distribution<int>(0, length)(rng);
+            return move.to_machine != move.from_machine or move.to_position != move.from_position;
+        }
+        if (kind < 7) {   // swap with a close job on the same machine
+            const int offset = std::uniform_int_distribution<int>(-3, 3)(rng);
+            move.type        = MoveType::Swap;
+            move.to_machine  = move.from_machine;
+            move.to_position = move.from_position + offset;
+            return offset != 0 and move.to_position >= 0 and
+                   move.to_position < static_cast<int>(sequences_[move.to_machine].size());
+        }
+
+        // reticle grouping: right after a job with the same reticle, to save the setup
+        const auto& mates = reticle_mates_[job];
+        if (mates.empty()) {
+            return false;
+        }
+        const int mate =
+            mates[std::uniform_int_distribution<size_t>(0, mates.size() - 1)(rng)];
+        const auto& candidates = job_machines_[job];
+        if (std::find(candidates.begin(), candidates.end(), job_machine_[mate]) ==
+            candidates.end()) {
+            return false;
+        }
+        move.type        = MoveType::Insert;
+        move.to_machine  = job_machine_[mate];
+        move.to_position = position_of(mate) + 1;
+        if (move.to_machine == move.from_machine and move.from_position < move.to_position) {
+            move.to_position--;
+        }
+        return move.to_machine != move.from_machine or move.to_position != move.from_position;
+    }
+
+    // apply the move and re-decode from the first step it can change
+    Undo apply(const Move& move)
+    {
+        Undo undo;
+        undo.objective = objective_;
+        undo.from_step = std::min(restart_step(move.from_machine, move.from_position),
+                                  restart_step(move.to_machine, move.to_position));
+        undo.sequences.emplace_back(move.from_machine, sequences_[move.from_machine]);
+        if (move.to_machine != move.from_machine) {
+            undo.sequences.emplace_back(move.to_machine, sequences_[move.to_machine]);
+        }
+
+        auto& from_sequence = sequences_[move.from_machine];
+        auto& to_sequence   = sequences_[move.to_machine];
+        if (move.type == MoveType::Swap) {
+            std::swap(from_sequence[move.from_position], to_sequence[move.to_position]);
+        }
+        else {
+            const int job = from_sequence[move.from_position];
+            from_sequence.erase(from_sequence.begin() + move.from_position);
+            to_sequence.insert(to_sequence.begin() + move.to_position, job);
+            job_machine_[job] = move.to_machine;
+        }
+
+        decode(undo);
+        return undo;
+    }
+
+    void revert(Undo& undo)
+    {
+        for (const auto& [machine, sequence] : undo.sequences) {
+            sequences_[machine] = sequence;
+            for (const auto job : sequence) {
+                job_machine_[job] = machine;
+            }
+        }
+        splice(undo);
+        objective_ = undo.objective;
+    }
+
+private:
+    int position_of(int job) const
+    {
+        const auto& sequence = sequences_[job_machine_[job]];
+        return std::find(sequence.begin(), sequence.end(), job) - sequence.begin();
+    }
+
+    // the decode picks the head of a machine sequence at each step, a change at (machine,
+    // position) is first seen once the task before it is decoded
+    int restart_step(int machine, int position) const
+    {
+        if (position == 0) {
+            return 0;
+        }
+        const int step = job_steps_[sequences_[machine][position - 1]];
+        return step >= 0 ? step + 1 : decoded_.size();
+    }
+
+    // number of jobs of the sequence decoded before the step. a machine is decoded in the order
+    // of its sequence, and stops at its first job that can't be placed
+    int decoded_prefix(const std::vector<int>& sequence, int step) const
+    {
+        return std::partition_point(sequence.begin(),
+                                    sequence.end(),
+                                    [&](int job) {
+                                        return job_steps_[job] >= 0 and job_steps_[job] < step;
+                                    }) -
+               sequence.begin();
+    }
+
+    int job_of(const ScheduledTask& task) const
+    {
+        return std::lower_bound(jobs_.begin(), jobs_.end(), task.job_id) - jobs_.begin();
+    }
+
+    // ends of the steps [from_step, end_step) and of the tree nodes above them. when the number
+    // of jobs is not a power of two a node can be in the same range as its children, the larger
+    // nodes are updated first
+    void update_ends(int from_step, int end_step)
+    {
+        if (from_step >= end_step) {
+            return;
+        }
+        std::size_t first = from_step + jobs_.size();
+        std::size_t last  = end_step - 1 + jobs_.size();
+        for (std::size_t node = first; node <= last; ++node) {
+            const int step  = node - jobs_.size();
+            end_tree_[node] = step < static_cast<int>(decoded_.size()) ? decoded_[step].end : 0;
+        }
+        for (first /= 2, last /= 2; first > 0; first /= 2, last /= 2) {
+            for (std::size_t node = last; node >= first; --node) {
+                end_tree_[node] = std::max(end_tree_[2 * node], end_tree_[2 * node + 1]);
+            }
+        }
+    }
+
+    int64_t tardiness_of(int job, const ScheduledTask& task) const
+    {
+        return std::max<int64_t>(0, task.end - due_times_[job]);
+    }
+
+    // exchange the decoded steps and the checkpoints of the undo with the ones they replace, the
+    // same call reverts it. a range changes its length only at the end of the decode
+    void splice(Undo& undo)
+    {
+        for (int step = undo.from_step; step < undo.end_step; ++step) {
+            const int job = job_of(decoded_[step]);
+            tardiness_ -= tardiness_of(job, decoded_[step]);
+            job_steps_[job] = -1;
+        }
+        const int end_step = undo.from_step + undo.tasks.size();
+        if (end_step == undo.end_step) {
+            std::swap_ranges(
+                undo.tasks.begin(), undo.tasks.end(), decoded_.begin() + undo.from_step);
+        }
+        else {
+            Schedule replaced(std::make_move_iterator(decoded_.begin() + undo.from_step),
+                              std::make_move_iterator(decoded_.end()));
+            decoded_.resize(undo.from_step);
+            decoded_.insert(decoded_.end(), undo.tasks.begin(), undo.tasks.end());
+            undo.tasks = std::move(replaced);
+        }
+        for (int step = undo.from_step; step < end_step; ++step) {
+            const int job = job_of(decoded_[step]);
+            tardiness_ += tardiness_of(job, decoded_[step]);
+            job_steps_[job] = step;
+        }
+        update_ends(undo.from_step, std::max(end_step, undo.end_step));
+        undo.end_step = end_step;
+
+        const int first_checkpoint = undo.from_step / CHECKPOINT_INTERVAL + 1;
+        const int checkpoint_end   = first_checkpoint + undo.checkpoints.size();
+        if (checkpoint_end == undo.checkpoint_end) {
+            std::swap_ranges(undo.checkpoints.begin(),
+                             undo.checkpoints.end(),
+                             checkpoints_.begin() + first_checkpoint);
+        }
+        else {
+            std::vector<DispatchState> replaced(
+                std::make_move_iterator(checkpoints_.begin() + first_checkpoint),
+                std::make_move_iterator(checkpoints_.end()));
+            checkpoints_.erase(checkpoints_.begin() + first_checkpoint, checkpoints_.end());
+            checkpoints_.insert(checkpoints_.end(),
+                                std::make_move_iterator(undo.checkpoints.begin()),
+                                std::make_move_iterator(undo.checkpoints.end()));
+            undo.checkpoints = std::move(replaced);
+        }
+        undo.checkpoint_end = checkpoint_end;
+
+        objective_ = end_tree_[1] + tardiness_ +
+                     UNPLACED_PENALTY * static_cast<int64_t>(jobs_.size() - decoded_.size());
+    }
+
+    // the new decode is back on the previous one after step: the same dispatch state as the
+    // previous checkpoint, and the same jobs left on each machine
+    bool converged(const Undo& undo, const DispatchState& state,
+                   const std::vector<int>& positions, int step) const
+    {
+        if (step >= static_cast<int>(decoded_.size()) or
+            !(state == checkpoints_[step / CHECKPOINT_INTERVAL])) {
+            return false;
+        }
+        for (int machine = 0; machine < static_cast<int>(machines_.size()); ++machine) {
+            const auto changed =
+                std::find_if(undo.sequences.begin(), undo.sequences.end(), [&](const auto& entry) {
+                    return entry.first == machine;
+                });
+            const auto& sequence = sequences_[machine];
+            if (changed == undo.sequences.end()) {
+                if (positions[machine] != decoded_prefix(sequence, step)) {
+                    return false;
+                }
+                continue;
+            }
+            const auto& previous = changed->second;
+            const int   position = decoded_prefix(previous, step);
+            if (sequence.size() - positions[machine] != previous.size() - position or
+                !std::equal(sequence.begin() + positions[machine],
+                            sequence.end(),
+                            previous.begin() + position)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // schedule the machine heads in the order of their earliest start, from undo.from_step until
+    // the decode meets the previous one or ends. the start of a head only changes when its
+    // machine or its reticle gets a new task, the others are kept. the decoded steps stay the
+    // previous ones until the splice, they are read by converged
+    void decode(Undo& undo)
+    {
+        const int from_step = undo.from_step;
+
+        // from the last checkpoint before the step
+        const int     checkpoint = from_step / CHECKPOINT_INTERVAL;
+        DispatchState state      = checkpoints_[checkpoint];
+        for (int step = checkpoint * CHECKPOINT_INTERVAL; step < from_step; ++step) {
+            state.append(decoded_[step]);
+        }
+
+        const int        num_machines = machines_.size();
+        std::vector<int> positions(num_machines);
+        for (int machine = 0; machine < num_machines; ++machine) {
+            positions[machine] = decoded_prefix(sequences_[machine], from_step);
+        }
+
+        undo.tasks.clear();
+        undo.checkpoints.clear();
+        undo.end_step       = decoded_.size();
+        undo.checkpoint_end = checkpoints_.size();
+
+        std::vector<ScheduledTask> heads(num_machines);
+        std::vector<ReticleID>     head_reticles(num_machines);
+        std::vector<char>          head_ready(num_machines, 0);   // 0: stale, 1: ok, 2: blocked
+        while (true) {
+            int best_machine = -1;
+            for (int machine = 0; machine < num_machines; ++machine) {
+                const int position = positions[machine];
+                if (position >= static_cast<int>(sequences_[machine].size())) {
+                    continue;
+                }
+                if (head_ready[machine] == 0) {
+                    const auto job_id      = jobs_[sequences_[machine][position]];
+                    head_reticles[machine] = inst_data_.job_reticle_pairs.at(job_id);
+                    head_ready[machine] =
+                        state.next_task(job_id, machines_[machine], heads[machine]) ? 1 : 2;
+                }
+                if (head_ready[machine] == 1 and
+                    (best_machine < 0 or heads[machine].start < heads[best_machine].start)) {
+                    best_machine = machine;
+                }
+            }
+            if (best_machine < 0) {
+                break;
+            }
+
+            const auto task = heads[best_machine];
+            state.append(task);
+            undo.tasks.push_back(task);
+            positions[best_machine]++;
+            const int step = from_step + undo.tasks.size();
+            if (step % CHECKPOINT_INTERVAL == 0) {
+                if (converged(undo, state, positions, step)) {
+                    undo.end_step       = step;
+                    undo.checkpoint_end = step / CHECKPOINT_INTERVAL;
+                    break;
+                }
+                undo.checkpoints.push_back(state);
+            }
+            // a blocked head may wait for the previous layer of its lot
+            for (int machine = 0; machine < num_machines; ++machine) {
+                if (machine == best_machine or head_reticles[machine] == task.reticle_id or
+                    head_ready[machine] == 2) {
+                    head_ready[machine] = 0;
+                }
+            }
+        }
+
+        splice(undo);
+    }
+
+    const InstData&               inst_data_;
+    std::vector<JobID>            jobs_;
+    std::vector<MachineID>        machines_;
+    std::map<MachineID, int>      machine_index_;
+    std::vector<std::vector<int>> job_machines_;    // candidate machines of each job
+    std::vector<std::vector<int>> reticle_mates_;   // other jobs with the same reticle
+
+    std::vector<std::vector<int>> sequences_;
+    std::vector<int>              job_machine_;
+    Schedule                      decoded_;
+    std::vector<int>              job_steps_;     // -1 when the job is not decoded
+    std::vector<DispatchState>    checkpoints_;   // state after each CHECKPOINT_INTERVAL steps
+    std::vector<int64_t>          end_tree_;      // max tree of the task ends by step
+    std::vector<int64_t>          due_times_;     // by job
+    int64_t                       tardiness_ = 0;
+    int64_t                       objective_ = 0;
+};
+
+struct SearchResult
+{
+    int64_t  objective = std::numeric_limits<int64_t>::max();
+    Schedule schedule;
+    int64_t  iterations = 0;
+};
+
+SearchResult run_search(const Schedule& schedule, const InstData& inst_data,
+                        const LocalSearchOptions& options, int thread_id)
+{
+    std::mt19937_64 rng(options.random_seed + thread_id);
+    SequenceSearch  search(schedule, inst_data);
+    SearchResult    result;
+
+    // perturb the start of the other threads to diversify the runs
+    for (int i = 0; i < 3 * thread_id; ++i) {
+        Move move;
+        if (search.random_move(rng, move)) {
+            search.apply(move);
+        }
+    }
+
+    auto update_best = [&]() {
+        if (search.objective() < result.objective) {
+            result.objective = search.objective();
+            result.schedule  = search.decoded();
+        }
+    };
+    update_best();
+
+    const double initial_temperature = options.initial_temperature > 0
+                                           ? options.initial_temperature
+                                           : std::max(1.0, 0.02 * (search.objective() %
+                                                                   UNPLACED_PENALTY));
+    std::vector<int64_t> tabu_until(search.num_jobs(), 0);
+
+    const auto start_time = std::chrono::steady_clock::now();
+    double     progress   = 0.0;
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    for (int64_t iteration = 1; progress < 1.0; ++iteration) {
+        if (iteration % 32 == 0) {
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+            progress = elapsed.count() / options.time_limit;
+        }
+        result.iterations = iteration;
+
+        if (options.acceptance == Acceptance::SimulatedAnnealing) {
+            Move move;
+            if (!search.random_move(rng, move)) {
+                continue;
+            }
+            const double temperature = initial_temperature * std::pow(0.001, progress);
+            const auto   before      = search.objective();
+            auto         undo        = search.apply(move);
+            const auto   delta       = search.objective() - before;
+            if (delta > 0 and uniform(rng) >= std::exp(-delta / temperature)) {
+                search.revert(undo);
+            }
+            update_best();
+            continue;
+        }
+
+        // tabu: the moved jobs can't move again for tabu_tenure iterations, unless the move
+        // gives a new best
+        bool    found = false;
+        Move    best_move;
+        int64_t best_objective = 0;
+        for (int candidate = 0; candidate < options.tabu_candidates; ++candidate) {
+            Move move;
+            if (!search.random_move(rng, move)) {
+                continue;
+            }
+            const int  job  = search.job_at(move.from_machine, move.from_position);
+            auto       undo = search.apply(move);
+            const auto objective = search.objective();
+            search.revert(undo);
+            if (tabu_until[job] > iteration and objective >= result.objective) {
+                continue;
+            }
+            if (!found or objective < best_objective) {
+                found          = true;
+                best_move      = move;
+                best_objective = objective;
+            }
+        }
+        if (!found) {
+            continue;
+        }
+        tabu_until[search.job_at(best_move.from_machine, best_move.from_position)] =
+            iteration + options.tabu_tenure;
+        if (best_move.type == MoveType::Swap) {
+            tabu_until[search.job_at(best_move.to_machine, best_move.to_position)] =
+                iteration + options.tabu_tenure;
+        }
+        search.apply(best_move);
+        update_best();
+    }
+
+    return result;
+}
+
+}   // namespace
+
+Schedule improve_schedule(const Schedule& schedule, const InstData& inst_data,
+                          const LocalSearchOptions& options)
+{
+    if (inst_data.processing_times.empty()) {
+        return schedule;
+    }
+
+    const int                 num_threads = std::max(1, options.num_threads);
+    std::vector<SearchResult> results(num_threads);
+    std::vector<std::thread>  threads;
+    for (int thread_id = 0; thread_id < num_threads; ++thread_id) {
+        threads.emplace_back([&, thread_id]() {
+            results[thread_id] = run_search(schedule, inst_data, options, thread_id);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto best = std::min_element(
+        results.begin(), results.end(), [](const auto& result1, const auto& result2) {
+            return result1.objective < result2.objective;
+        });
+
+    if (DEBUG) {
+        for (int thread_id = 0; thread_id < num_threads; ++thread_id) {
+            std::cout << "Local search thread " << thread_id << ": "
+                      << results[thread_id].iterations << " iterations, objective "
+                      << results[thread_id].objective << std::endl;
+        }
+    }
+
+    // keep the given schedule unless the search found a better complete one
+    const auto evaluation = evaluate_schedule(schedule, inst_data);
+    if (best->objective >= UNPLACED_PENALTY or
+        (evaluation.feasible() and evaluation.objective <= best->objective)) {
+        return schedule;
+    }
+    return best->schedule;
+}
+
+}   // namespace sat
+}   // namespace operations_research
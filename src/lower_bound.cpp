@@ -0,0 +1,285 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "ortools/sat/cp_model.h"
+#include "ortools/sat/model.h"
+#include "ortools/util/time_limit.h"
+
+#include "lower_bound.hpp"
+#include "types.hpp"
+
+namespace operations_research {
+namespace sat {
+constexpr bool DEBUG = true;
+
+namespace {
+
+struct JobBound
+{
+    int64_t release;      // earliest start over the machines of the job
+    int64_t processing;   // shortest processing time
+    int64_t end;          // earliest end
+    int64_t due;
+    int64_t setup;        // smallest setup before the job when it is not first, or 0
+};
+
+int64_t sum_job_tardiness(const std::vector<JobBound>& jobs)
+{
+    int64_t tardiness = 0;
+    for (const auto& job : jobs) {
+        tardiness += std::max<int64_t>(0, job.end - job.due);
+    }
+    return tardiness;
+}
+
+// the jobs share a resource (a machine or a reticle) and are processed one after the other: the
+// max over the release times t of t + the work of the jobs released at t or later. all these jobs
+// but the first one follow another job, and are set up
+int64_t release_load_bound(std::vector<JobBound> jobs)
+{
+    std::sort(jobs.begin(), jobs.end(), [](const auto& job1, const auto& job2) {
+        return job1.release > job2.release;
+    });
+
+    int64_t work      = 0;
+    int64_t max_setup = 0;
+    int64_t bound     = 0;
+    for (const auto& job : jobs) {
+        work += job.processing + job.setup;
+        max_setup = std::max(max_setup, job.setup);
+        bound     = std::max(bound, job.release + work - max_setup);
+    }
+    return bound;
+}
+
+// the jobs share a resource. with the release times relaxed to the earliest one, the k-th job to
+// complete ends at the earliest after the k shortest jobs, matched with the k-th earliest due time
+// it gives a bound of the total tardiness (SPT / EDD relaxation)
+int64_t edd_tardiness_bound(const std::vector<JobBound>& jobs)
+{
+    if (jobs.empty()) {
+        return 0;
+    }
+
+    std::vector<int64_t> processing_times;
+    std::vector<int64_t> due_times;
+    int64_t              completion = std::numeric_limits<int64_t>::max();
+    for (const auto& job : jobs) {
+        processing_times.push_back(job.processing);
+        due_times.push_back(job.due);
+        completion = std::min(completion, job.release);
+    }
+    std::sort(processing_times.begin(), processing_times.end());
+    std::sort(due_times.begin(), due_times.end());
+
+    int64_t tardiness = 0;
+    for (std::size_t k = 0; k < jobs.size(); ++k) {
+        completion += processing_times[k];
+        tardiness += std::max<int64_t>(0, completion - due_times[k]);
+    }
+
+    return std::max(tardiness, sum_job_tardiness(jobs));
+}
+
+}   // namespace
+
+int64_t find_earliest_start(const InstData& inst_data, TaskID task_id)
+{
+    const auto [job_id, machine_id] = task_id;
+    const auto reticle_id           = inst_data.job_reticle_pairs.at(job_id);
+
+    // a reticle away from the machine is transferred there first, then set up
+    int64_t start = inst_data.job_release_times.at(job_id);
+    if (inst_data.reticle_init_positions.at(reticle_id) != machine_id and
+        inst_data.changeovers.has_machine(machine_id)) {
+        start = std::max<int64_t>(
+            start, inst_data.changeovers.get_min_transfer_in(machine_id) + TRANSFER_SETUP_TIME);
+    }
+    return start;
+}
+
+LowerBound compute_lower_bound(const InstData& inst_data)
+{
+    const auto  begin       = std::chrono::steady_clock::now();
+    const auto& changeovers = inst_data.changeovers;
+
+    std::map<JobID, std::vector<std::pair<MachineID, TimeStamp>>> job_tasks;
+    std::set<MachineID>                                            machines;
+    for (const auto& [task_id, processing_time] : inst_data.processing_times) {
+        const auto [job_id, machine_id] = task_id;
+        job_tasks[job_id].push_back({machine_id, processing_time});
+        machines.insert(machine_id);
+    }
+
+    LowerBound lower_bound;
+
+    std::map<MachineID, std::vector<JobBound>> machine_jobs;   // the jobs with a single machine
+    std::map<ReticleID, std::vector<JobBound>> reticle_jobs;
+    int64_t total_work  = 0;
+    int64_t min_release = std::numeric_limits<int64_t>::max();
+    for (const auto& [job_id, tasks] : job_tasks) {
+        const auto reticle_id = inst_data.job_reticle_pairs.at(job_id);
+
+        JobBound job = {std::numeric_limits<int64_t>::max(),
+                        std::numeric_limits<int64_t>::max(),
+                        std::numeric_limits<int64_t>::max(),
+                        inst_data.job_due_times.at(job_id),
+                        0};
+        for (const auto& [machine_id, processing_time] : tasks) {
+            const auto start = find_earliest_start(inst_data, {job_id, machine_id});
+            job.release      = std::min(job.release, start);
+            job.processing   = std::min<int64_t>(job.processing, processing_time);
+            job.end          = std::min(job.end, start + processing_time);
+        }
+
+        lower_bound.job_makespan = std::max(lower_bound.job_makespan, job.end);
+        total_work += job.processing;
+        min_release = std::min(min_release, job.release);
+
+        // jobs may share a reticle on different machines, without a setup between them
+        reticle_jobs[reticle_id].push_back(job);
+
+        const auto machine_id = tasks.front().first;
+        if (tasks.size() == 1 and changeovers.has_machine(machine_id)) {
+            const auto local_index = changeovers.get_local_index(machine_id, job_id);
+            if (local_index >= 0) {
+                job.setup = changeovers.get_min_setup_in(machine_id, local_index);
+            }
+            machine_jobs[machine_id].push_back(job);
+        }
+    }
+
+    // makespan
+    for (const auto& [machine_id, jobs] : machine_jobs) {
+        lower_bound.machine_makespan =
+            std::max(lower_bound.machine_makespan, release_load_bound(jobs));
+    }
+    for (const auto& [reticle_id, jobs] : reticle_jobs) {
+        lower_bound.reticle_makespan =
+            std::max(lower_bound.reticle_makespan, release_load_bound(jobs));
+    }
+    if (!machines.empty()) {
+        const int64_t num_machines = machines.size();
+        lower_bound.parallel_makespan =
+            min_release + (total_work + num_machines - 1) / num_machines;
+    }
+    lower_bound.makespan = std::max({lower_bound.job_makespan,
+                                     lower_bound.machine_makespan,
+                                     lower_bound.reticle_makespan,
+                                     lower_bound.parallel_makespan});
+
+    // tardiness, the machine groups and the reticle groups each split the jobs
+    for (const auto& [reticle_id, jobs] : reticle_jobs) {
+        lower_bound.job_tardiness += sum_job_tardiness(jobs);
+        lower_bound.reticle_tardiness += edd_tardiness_bound(jobs);
+    }
+    lower_bound.machine_tardiness = lower_bound.job_tardiness;
+    for (const auto& [machine_id, jobs] : machine_jobs) {
+        lower_bound.machine_tardiness += edd_tardiness_bound(jobs) - sum_job_tardiness(jobs);
+    }
+    lower_bound.tardiness = std::max({lower_bound.job_tardiness,
+                                      lower_bound.machine_tardiness,
+                                      lower_bound.reticle_tardiness});
+
+    lower_bound.objective = lower_bound.makespan + lower_bound.tardiness;
+    lower_bound.compute_time =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    return lower_bound;
+}
+
+GapReport compute_gap(const CpSolverResponse& response, const LowerBound& lower_bound)
+{
+    GapReport report;
+    report.solver_bound = static_cast<int64_t>(std::ceil(response.best_objective_bound()));
+    report.bound        = std::max(report.solver_bound, lower_bound.objective);
+
+    if (response.status() == CpSolverStatus::OPTIMAL or
+        response.status() == CpSolverStatus::FEASIBLE) {
+        report.objective = std::llround(response.objective_value());
+        report.gap       = report.objective > 0
+                               ? std::max<double>(0, report.objective - report.bound) /
+                                     report.objective
+                               : 0;
+    }
+
+    return report;
+}
+
+void add_gap_limit(Model& model, const LowerBound& lower_bound, double gap_target,
+                   std::atomic<bool>& stop)
+{
+    // shared by the callbacks, which are called from the solver threads
+    struct GapState
+    {
+        std::atomic<int64_t> objective = std::numeric_limits<int64_t>::max();
+        std::atomic<int64_t> bound     = 0;
+    };
+    auto state = std::make_shared<GapState>();
+    state->bound = lower_bound.objective;
+
+    const auto check_gap = [state, gap_target, &stop]() {
+        const auto objective = state->objective.load();
+        if (objective == std::numeric_limits<int64_t>::max()) {
+            return;
+        }
+        if (objective - state->bound.load() <= gap_target * objective) {
+            if (DEBUG and !stop) {
+                std::cout << "Gap target " << gap_target << " reached, objective " << objective
+                          << ", bound " << state->bound.load() << std::endl;
+            }
+            stop = true;
+        }
+    };
+
+    const auto update_bound = [state](int64_t bound) {
+        auto current = state->bound.load();
+        while (bound > current and !state->bound.compare_exchange_weak(current, bound)) {}
+    };
+
+    model.Add(NewFeasibleSolutionObserver([=](const CpSolverResponse& response) {
+        state->objective = std::llround(response.objective_value());
+        update_bound(static_cast<int64_t>(std::ceil(response.best_objective_bound())));
+        check_gap();
+    }));
+    model.Add(NewBestBoundCallback([=](double bound) {
+        update_bound(static_cast<int64_t>(std::ceil(bound)));
+        check_gap();
+    }));
+    model.GetOrCreate<TimeLimit>()->RegisterExternalBooleanAsLimit(&stop);
+}
+
+void print_lower_bound(const LowerBound& lower_bound)
+{
+    std::cout << "Lower bound: " << lower_bound.objective << " (makespan " << lower_bound.makespan
+              << " + tardiness " << lower_bound.tardiness << "), computed in "
+              << lower_bound.compute_time << " s" << std::endl;
+    std::cout << "Makespan bounds: job " << lower_bound.job_makespan << ", machine "
+              << lower_bound.machine_makespan << ", reticle " << lower_bound.reticle_makespan
+              << ", parallel " << lower_bound.parallel_makespan << std::endl;
+    std::cout << "Tardiness bounds: job " << lower_bound.job_tardiness << ", machine "
+              << lower_bound.machine_tardiness << ", reticle " << lower_bound.reticle_tardiness
+              << std::endl;
+}
+
+void print_gap_report(const GapReport& report)
+{
+    if (report.objective < 0) {
+        std::cout << "Best bound: " << report.bound << " (solver " << report.solver_bound << ")"
+                  << std::endl;
+        return;
+    }
+    std::cout << "Objective: " << report.objective << ", best bound: " << report.bound
+              << " (solver " << report.solver_bound << "), gap: " << 100 * report.gap << " %"
+              << std::endl;
+}
+
+}   // namespace sat
+}   // namespace operations_research
@@ -1,75 +1,158 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
 #include <map>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "ortools/sat/cp_model.h"
 #include "ortools/sat/model.h"
 #include "ortools/sat/sat_parameters.pb.h"
 
+#include "async_solve.hpp"
 #include "build_model.hpp"
+#include "decomposition.hpp"
+#include "lower_bound.hpp"
+#include "model_dump.hpp"
+#include "portfolio.hpp"
 #include "read_data.hpp"
+#include "solution_writer.hpp"
 #include "solve_model.hpp"
+#include "telemetry.hpp"
 #include "types.hpp"
-
-int main()
+#include "warm_start.hpp"
+
+// usage: litho_scheduling [--portfolio] [--deterministic] [--seed N] [--memory-budget GB]
+//                         [--transport-capacity N] [--warm-start sol.csv] [--time-shift T]
+//                         [--freeze-until T] [--gap-target G] [--telemetry file]
+//                         [--rank] [--decomposition] [--no-reserve] [--dispatch-after S]
+//                         [--dump bundle.bin] [--campaign-usage] [--prune-alternatives]
+int main(int argc, char** argv)
 {
+    bool   use_portfolio      = false;
+    bool   deterministic      = false;
+    int    random_seed        = 0;
+    int    memory_budget      = 0;   // GB
+    int    capacity           = 0;   // reticles in flight at once
+    bool   warm_start         = false;
+    double gap_target         = 0;   // relative gap to stop the solve at, 0: none
+    bool   rank               = false;   // rank formulation of the machine sequences
+    bool   decomposition      = false;   // assignment-then-sequencing decomposition
+    bool   reserve            = true;   // size the proto from the model estimate
+    int    dispatch_after     = 0;   // seconds, cut the solve short with its best solution, 0: no
+    bool   campaign_usage     = false;   // count the reticle uses until a requalification
+    bool   prune_alternatives = false;   // drop the slow machine alternatives, heuristic
+
+    std::string telemetry_file;   // .csv or .jsonl, empty: none
+    std::string dump_file;        // model bundle for litho_replay, empty: none
+
+    operations_research::sat::WarmStartOptions warm_start_options;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--portfolio") {
+            use_portfolio = true;
+        }
+        else if (arg == "--deterministic") {
+            deterministic = true;
+        }
+        else if (arg == "--seed" and i + 1 < argc) {
+            random_seed = std::stoi(argv[++i]);
+        }
+        else if (arg == "--memory-budget" and i + 1 < argc) {
+            memory_budget = std::stoi(argv[++i]);
+        }
+        else if (arg == "--transport-capacity" and i + 1 < argc) {
+            capacity = std::stoi(argv[++i]);
+        }
+        else if (arg == "--warm-start" and i + 1 < argc) {
+            warm_start                   = true;
+            warm_start_options.file_name = argv[++i];
+        }
+        else if (arg == "--time-shift" and i + 1 < argc) {
+            warm_start_options.time_shift = std::stoi(argv[++i]);
+        }
+        else if (arg == "--freeze-until" and i + 1 < argc) {
+            warm_start_options.freeze_until = std::stoi(argv[++i]);
+        }
+        else if (arg == "--gap-target" and i + 1 < argc) {
+            gap_target = std::stod(argv[++i]);
+        }
+        else if (arg == "--telemetry" and i + 1 < argc) {
+            telemetry_file = argv[++i];
+        }
+        else if (arg == "--rank") {
+            rank = true;
+        }
+        else if (arg == "--decomposition") {
+            decomposition = true;
+        }
+        else if (arg == "--no-reserve") {
+            reserve = false;
+        }
+        else if (arg == "--dispatch-after" and i + 1 < argc) {
+            dispatch_after = std::stoi(argv[++i]);
+        }
+        else if (arg == "--dump" and i + 1 < argc) {
+            dump_file = argv[++i];
+        }
+        else if (arg == "--campaign-usage") {
+            campaign_usage = true;
+        }
+        else if (arg == "--prune-alternatives") {
+            prune_alternatives = true;
+        }
+    }
+
     // operations_research::sat::MinimalJobshopSat();
     // Read Data *******************************************************************************
-    operations_research::sat::InstData inst_data;
-    inst_data.job_ded_machines  = operations_research::sat::read_dedicated_machine_data();
-    inst_data.job_release_times = operations_research::sat::read_job_release_time_data();
-    inst_data.job_due_times     = operations_research::sat::read_job_due_time_data();
-    inst_data.job_reticle_pairs = operations_research::sat::read_job_reticle_pair_data();
-    auto all_task_ptime_map     = operations_research::sat::read_job_processing_time_data();
-    operations_research::sat::filter_tasks(all_task_ptime_map, inst_data);
-
-    inst_data.setup_times            = operations_research::sat::read_setup_time_data();
-    inst_data.transfer_times         = operations_research::sat::read_transfer_time_data();
-    inst_data.reticle_sharing_limits = operations_research::sat::read_reticle_sharing_data();
-    inst_data.reticle_init_positions = operations_research::sat::read_reticle_init_positions_data();
-    inst_data.reticle_init_usage     = operations_research::sat::read_reticle_init_usage();
-
-    // Prepare Data *****************************************************************************
-
-    auto max_horizon = operations_research::sat::find_max_horizon(inst_data);
-    auto max_transfer_time_map =
-        operations_research::sat::find_machine_max_transfer_time(inst_data);
-    auto max_setup_time_map = operations_research::sat::find_task_max_setup_time(inst_data);
+    // with a memory budget, the task setup matrix may take a quarter of it
+    const auto budget_bytes = static_cast<std::size_t>(memory_budget) << 30;
+    auto       inst_data    = operations_research::sat::read_inst_data(
+        budget_bytes > 0 ? budget_bytes / 4 : operations_research::sat::MAX_TASK_SETUP_BYTES);
+    if (campaign_usage) {
+        inst_data.reticle_usage_rule = operations_research::sat::ReticleUsageRule::Campaign;
+    }
+
+    const auto lower_bound = operations_research::sat::compute_lower_bound(inst_data);
+    operations_research::sat::print_lower_bound(lower_bound);
+
+    // Portfolio *******************************************************************************
+    if (use_portfolio) {
+        auto result = operations_research::sat::run_portfolio(inst_data, 16, 60);
+        operations_research::sat::print_schedule(result.schedule);
+        return 0;
+    }
+
+    // Decomposition ***************************************************************************
+    if (decomposition) {
+        auto result = operations_research::sat::solve_by_decomposition(
+            inst_data, operations_research::sat::DecompositionOptions());
+        operations_research::sat::print_decomposition_result(result);
+        operations_research::sat::print_schedule(result.schedule);
+        return 0;
+    }
 
     // Build Model ******************************************************************************
-    operations_research::sat::CpModelBuilder cp_model;
-    operations_research::sat::TaskVars       task_vars;
-
-    operations_research::sat::add_task_transfer_vars(cp_model, task_vars, inst_data);
-    operations_research::sat::add_task_setup_vars(cp_model, task_vars, inst_data);
-    operations_research::sat::add_task_start_vars(cp_model, task_vars, inst_data, max_horizon);
-    operations_research::sat::add_task_end_vars(cp_model, task_vars, inst_data, max_horizon);
-    operations_research::sat::add_task_presence_vars(cp_model, task_vars, inst_data);
-    operations_research::sat::add_task_optional_interval_vars(cp_model, task_vars, inst_data);
-    operations_research::sat::add_reticle_sharing_vars(cp_model, task_vars, inst_data);
-
-    // not used now
-    operations_research::sat::add_task_position_vars(cp_model, task_vars, inst_data);
-
-    // constraints ******************************************************************************
-    operations_research::sat::add_task_precense_constraints(cp_model, task_vars);
-    operations_research::sat::add_job_release_time_constraints(cp_model, task_vars, inst_data);
-    operations_research::sat::add_reticle_max_sharing_constraints(cp_model, task_vars, inst_data);
-    operations_research::sat::add_machine_no_overlap_constraints(cp_model, task_vars);
-    operations_research::sat::add_reticle_no_overlap_constraints(cp_model, task_vars, inst_data);
-    operations_research::sat::add_setup_constraints(cp_model, task_vars, inst_data);
-    operations_research::sat::add_transfer_constraints(cp_model, task_vars, inst_data);
-
-    // obj **************************************************************************************
+    operations_research::sat::CpModelBuilder      cp_model;
+    operations_research::sat::TaskVars            task_vars;
+    operations_research::sat::ModelIndex          model_index;
     std::vector<operations_research::sat::IntVar> obj_exprs;
-    operations_research::sat::add_obj_minimize_makespan(
-        cp_model, task_vars, obj_exprs, max_horizon);
-    // operations_research::sat::add_obj_minimize_transfer_time(
-    //     cp_model, task_vars, obj_exprs, max_horizon);
-    // operations_research::sat::add_obj_minimize_setup_time(
-    //     cp_model, task_vars, obj_exprs, max_horizon);
-    operations_research::sat::add_obj_minimize_tardiness(cp_model, task_vars, obj_exprs, inst_data);
-
-    cp_model.Minimize(operations_research::sat::LinearExpr::Sum(obj_exprs));
+    operations_research::sat::BuildOptions        build_options;
+    build_options.fixed_search_order      = deterministic;
+    build_options.memory_budget           = budget_bytes;
+    build_options.transport_capacity      = capacity;
+    build_options.record_arc_literals     = warm_start;
+    build_options.reserve_proto           = reserve;
+    build_options.prune_slow_alternatives = prune_alternatives;
+    if (rank) {
+        build_options.sequencing_formulation =
+            operations_research::sat::SequencingFormulation::Rank;
+    }
+
+    operations_research::sat::build_model(
+        cp_model, task_vars, model_index, obj_exprs, inst_data, build_options);
 
     // solve ***********************************************************************************
     operations_research::sat::Model         model;
@@ -77,16 +160,86 @@ int main()
 
     operations_research::sat::set_time_limit(parameters, 60);
     operations_research::sat::set_num_search_workers(parameters, 16);
+    if (deterministic) {
+        operations_research::sat::set_deterministic_mode(parameters, random_seed, 60.0);
+    }
     operations_research::sat::enable_log_search_progress(parameters);
+    if (warm_start) {
+        auto schedule = operations_research::sat::load_warm_start(inst_data, warm_start_options);
+        operations_research::sat::add_warm_start(cp_model, task_vars, schedule, warm_start_options);
+    }
     operations_research::sat::add_parameters_to_model(model, parameters);
-
-    auto response = operations_research::sat::solve_model(model, cp_model);
+    operations_research::sat::print_parameters(parameters);
+
+    // export each improving solution, so the last one is on disk if the solve is interrupted
+    operations_research::sat::SolutionExporter exporter(task_vars, inst_data);
+    model.Add(operations_research::sat::NewFeasibleSolutionObserver(
+        [&](const operations_research::sat::CpSolverResponse& solution) {
+            exporter.extract(solution);
+            exporter.write_csv("data/sol.csv");
+            exporter.write_arrow("data/sol.arrow");
+        }));
+
+    std::atomic<bool> stop = false;
+    if (gap_target > 0) {
+        operations_research::sat::add_gap_limit(model, lower_bound, gap_target, stop);
+    }
+
+    std::unique_ptr<operations_research::sat::SolveTelemetry> telemetry;
+    if (!telemetry_file.empty()) {
+        telemetry = std::make_unique<operations_research::sat::SolveTelemetry>(
+            telemetry_file, lower_bound.objective);
+        telemetry->attach(model);
+    }
+
+    // the bundle is written before the solve, so a crashed or killed solve can still be replayed,
+    // and written again with the response. it is built for each write, not kept during the solve
+    const uint64_t input_hash =
+        dump_file.empty() ? 0 : operations_research::sat::hash_input_files();
+    auto dump_bundle = [&](const operations_research::sat::CpSolverResponse& response) {
+        operations_research::sat::ModelBundle bundle;
+        bundle.model      = cp_model.Proto();
+        bundle.parameters = parameters;
+        bundle.input_hash = input_hash;
+        bundle.response   = response;
+        operations_research::sat::write_model_bundle(dump_file, bundle);
+    };
+    if (!dump_file.empty()) {
+        dump_bundle(operations_research::sat::CpSolverResponse());
+    }
+
+    operations_research::sat::CpSolverResponse response;
+    if (dispatch_after > 0) {
+        // the lots are dispatched at that time with the best schedule found so far
+        auto handle = operations_research::sat::solve_model_async(model, cp_model);
+        if (!handle->wait_for(std::chrono::seconds(dispatch_after))) {
+            handle->cancel();
+        }
+        response = handle->wait();
+    }
+    else {
+        response = operations_research::sat::solve_model(model, cp_model);
+    }
+    if (telemetry) {
+        telemetry->finish(response);
+    }
+    if (!dump_file.empty()) {
+        dump_bundle(response);
+    }
 
     operations_research::sat::print_obj_val(response);
     operations_research::sat::print_response_status(response);
     operations_research::sat::print_response_statistics(response);
-    operations_research::sat::print_solution(response, task_vars, inst_data);
+    operations_research::sat::print_gap_report(
+        operations_research::sat::compute_gap(response, lower_bound));
+    if (response.status() == operations_research::sat::CpSolverStatus::OPTIMAL or
+        response.status() == operations_research::sat::CpSolverStatus::FEASIBLE) {
+        exporter.extract(response);
+        exporter.write_csv("data/sol.csv");
+        exporter.write_arrow("data/sol.arrow");
+        std::cout << "solution with " << exporter.columns().size()
+                  << " tasks written to data/sol.csv and data/sol.arrow\n";
+    }
 
     return 0;
 }
-
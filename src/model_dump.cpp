@@ -0,0 +1,176 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "ortools/sat/cp_model.h"
+#include "ortools/sat/sat_parameters.pb.h"
+
+#include "model_dump.hpp"
+#include "types.hpp"
+
+namespace operations_research {
+namespace sat {
+
+namespace {
+
+constexpr char     BUNDLE_MAGIC[8] = {'L', 'I', 'T', 'H', 'O', 'D', 'M', 'P'};
+constexpr uint32_t BUNDLE_VERSION  = 1;
+
+constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+constexpr uint64_t FNV_PRIME        = 1099511628211ull;
+
+// the files of read_inst_data
+const std::vector<std::string> INPUT_FILES = {
+    "dedicated_machines.csv",
+    "job_release_time.csv",
+    "job_due_time.csv",
+    "job_processing_time.csv",
+    "reticle_sharing.csv",
+    "setup_time.csv",
+    "transfer_time.csv",
+    "reticle_init_positions.csv",
+    "reticle_init_usage.csv",
+    "job_reticle_pairs.csv",
+    "machine_calendar.csv",
+    "lot_routes.csv",
+};
+
+uint64_t fnv1a(uint64_t hash, const std::string& bytes)
+{
+    for (const unsigned char byte : bytes) {
+        hash = (hash ^ byte) * FNV_PRIME;
+    }
+    return hash;
+}
+
+// little-endian fixed size fields, as written on x86 and arm
+template <typename T>
+void append_value(std::string& content, T value)
+{
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    content.append(bytes, sizeof(T));
+}
+
+template <typename T>
+bool read_value(const std::string& content, std::size_t& offset, T& value)
+{
+    if (offset + sizeof(T) > content.size()) {
+        return false;
+    }
+    std::memcpy(&value, content.data() + offset, sizeof(T));
+    offset += sizeof(T);
+    return true;
+}
+
+void append_message(std::string& content, const std::string& message)
+{
+    append_value<uint64_t>(content, message.size());
+    content += message;
+}
+
+bool read_message(const std::string& content, std::size_t& offset, std::string& message)
+{
+    uint64_t size = 0;
+    if (!read_value(content, offset, size) or offset + size > content.size()) {
+        return false;
+    }
+    message = content.substr(offset, size);
+    offset += size;
+    return true;
+}
+
+}   // namespace
+
+uint64_t hash_input_files(const std::string& directory)
+{
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (const auto& file_name : INPUT_FILES) {
+        std::ifstream      file(directory + "/" + file_name, std::ios::binary);
+        std::ostringstream content;
+        content << file.rdbuf();
+        hash = fnv1a(fnv1a(hash, file_name), content.str());
+    }
+    return hash;
+}
+
+bool write_model_bundle(const std::string& file_name, const ModelBundle& bundle)
+{
+    std::string content(BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC));
+    append_value(content, BUNDLE_VERSION);
+    append_value(content, bundle.input_hash);
+    append_message(content, bundle.model.SerializeAsString());
+    append_message(content, bundle.parameters.SerializeAsString());
+    append_message(content, bundle.response.SerializeAsString());
+
+    // a complete bundle or none, as the solution files
+    const auto    temp_name = file_name + ".tmp";
+    std::ofstream file(temp_name, std::ios::binary);
+    file.write(content.data(), content.size());
+    file.close();
+    if (!file or std::rename(temp_name.c_str(), file_name.c_str()) != 0) {
+        std::cerr << "Unable to write " << file_name << std::endl;
+        return false;
+    }
+    std::cout << "Model bundle written to " << file_name << ": " << (content.size() >> 10)
+              << " KB, input hash " << std::hex << bundle.input_hash << std::dec << std::endl;
+    return true;
+}
+
+bool read_model_bundle(const std::string& file_name, ModelBundle& bundle)
+{
+    std::ifstream file(file_name, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Unable to open " << file_name << " file" << std::endl;
+        return false;
+    }
+    std::ostringstream stream;
+    stream << file.rdbuf();
+    const auto content = stream.str();
+
+    std::size_t offset  = sizeof(BUNDLE_MAGIC);
+    uint32_t    version = 0;
+    std::string model, parameters, response;
+    if (content.compare(0, sizeof(BUNDLE_MAGIC), BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC)) != 0 or
+        !read_value(content, offset, version) or version != BUNDLE_VERSION or
+        !read_value(content, offset, bundle.input_hash) or
+        !read_message(content, offset, model) or !read_message(content, offset, parameters) or
+        !read_message(content, offset, response) or !bundle.model.ParseFromString(model) or
+        !bundle.parameters.ParseFromString(parameters) or
+        !bundle.response.ParseFromString(response)) {
+        std::cerr << "Invalid model bundle " << file_name << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void print_replay_diff(const std::string& name, const CpSolverResponse& recorded,
+                       const CpSolverResponse& replayed)
+{
+    auto row = [](const std::string& field, const auto& recorded_value,
+                  const auto& replayed_value) {
+        std::cout << std::left << std::setw(20) << field << std::setw(20) << recorded_value
+                  << replayed_value << std::endl;
+    };
+
+    std::cout << "== " << name << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    row("", "recorded", "replayed");
+    row("status",
+        CpSolverStatus_Name(recorded.status()),
+        CpSolverStatus_Name(replayed.status()));
+    row("objective", recorded.objective_value(), replayed.objective_value());
+    row("best bound", recorded.best_objective_bound(), replayed.best_objective_bound());
+    row("wall time (s)", recorded.wall_time(), replayed.wall_time());
+    row("deterministic time", recorded.deterministic_time(), replayed.deterministic_time());
+    row("conflicts", recorded.num_conflicts(), replayed.num_conflicts());
+    row("branches", recorded.num_branches(), replayed.num_branches());
+    std::cout << std::defaultfloat;
+}
+
+}   // namespace sat
+}   // namespace operations_research
@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include "ortools/sat/cp_model.h"
+#include "ortools/sat/model.h"
+#include "ortools/sat/sat_parameters.pb.h"
+#include "ortools/util/time_limit.h"
+
+#include "build_model.hpp"
+#include "evaluator.hpp"
+#include "heuristic.hpp"
+#include "portfolio.hpp"
+#include "solve_model.hpp"
+#include "types.hpp"
+
+namespace operations_research {
+namespace sat {
+
+namespace {
+
+// best schedule found by any member of the portfolio
+struct Incumbent
+{
+    std::mutex      mutex;
+    PortfolioResult result;
+};
+
+void update_incumbent(Incumbent& incumbent, const std::string& source, int64_t objective,
+                      Schedule schedule)
+{
+    std::lock_guard<std::mutex> lock(incumbent.mutex);
+    if (incumbent.result.objective >= 0 and objective >= incumbent.result.objective) {
+        return;
+    }
+
+    incumbent.result.winner    = source;
+    incumbent.result.status    = CpSolverStatus::FEASIBLE;
+    incumbent.result.objective = objective;
+    incumbent.result.schedule  = std::move(schedule);
+
+    std::cout << "Portfolio: " << source << " found objective " << objective << std::endl;
+}
+
+}   // namespace
+
+PortfolioResult run_portfolio(const InstData& inst_data, int num_search_workers, int time_limit)
+{
+    const std::vector<std::pair<std::string, BuildOptions>> formulations = {
+        {"circuit", {TransferFormulation::Circuit}},
+        {"id_circuit", {TransferFormulation::IdCircuit}},
+    };
+
+    const int formulation_workers =
+        std::max(1, num_search_workers / static_cast<int>(formulations.size()));
+
+    std::atomic<bool>        stop  = false;
+    std::atomic<bool>        proof = false;   // a member proved the incumbent optimal
+    Incumbent                incumbent;
+    std::vector<std::thread> members;
+
+    // the greedy heuristic is cheap, it runs before the formulations so that all of them start
+    // from its schedule. only a feasible schedule may bound the formulations
+    auto schedule   = greedy_schedule(inst_data);
+    auto evaluation = evaluate_schedule(schedule, inst_data);
+    if (evaluation.feasible()) {
+        update_incumbent(incumbent, "greedy", evaluation.objective, std::move(schedule));
+    }
+    else {
+        std::cout << "Portfolio: greedy schedule is not feasible" << std::endl;
+    }
+
+    for (const auto& [name, options] : formulations) {
+        members.emplace_back([&, name, options] {
+            CpModelBuilder      cp_model;
+            TaskVars            task_vars;
+            ModelIndex          model_index;
+            std::vector<IntVar> obj_exprs;
+            build_model(cp_model, task_vars, model_index, obj_exprs, inst_data, options);
+
+            // start from the incumbent, the greedy schedule or a better one if a formulation
+            // already found it. the bound is strict, so the member only searches for a better
+            // schedule and infeasible proves the incumbent optimal. the hinted schedule is then
+            // one above the bound, the solver repairs it
+            bool bounded = false;
+            {
+                std::lock_guard<std::mutex> lock(incumbent.mutex);
+                if (incumbent.result.objective >= 0) {
+                    add_solution_hint(cp_model, task_vars, incumbent.result.schedule);
+                    cp_model.AddLessOrEqual(LinearExpr::Sum(obj_exprs),
+                                            incumbent.result.objective - 1);
+                    bounded = true;
+                }
+            }
+
+            Model         model;
+            SatParameters parameters;
+            set_time_limit(parameters, time_limit);
+            set_num_search_workers(parameters, formulation_workers);
+            add_parameters_to_model(model, parameters);
+            model.GetOrCreate<TimeLimit>()->RegisterExternalBooleanAsLimit(&stop);
+            model.Add(NewFeasibleSolutionObserver([&](const CpSolverResponse& response) {
+                update_incumbent(incumbent,
+                                 name,
+                                 static_cast<int64_t>(response.objective_value()),
+                                 extract_schedule(response, task_vars, inst_data));
+            }));
+
+            auto response = solve_model(model, cp_model);
+            std::cout << "Portfolio: " << name << " stopped with status "
+                      << CpSolverStatus_Name(response.status()) << " after "
+                      << response.wall_time() << "s" << std::endl;
+
+            // optimal, or no schedule better than the incumbent: the incumbent is optimal. both
+            // formulations are exact (no memory budget), an infeasible one proves it
+            if (response.status() == CpSolverStatus::OPTIMAL or
+                (bounded and response.status() == CpSolverStatus::INFEASIBLE)) {
+                proof = true;
+                stop  = true;
+            }
+        });
+    }
+
+    for (auto& member : members) {
+        member.join();
+    }
+
+    auto result = std::move(incumbent.result);
+    if (proof and result.objective >= 0) {
+        result.status = CpSolverStatus::OPTIMAL;
+    }
+
+    std::cout << "Portfolio: best objective " << result.objective << " found by " << result.winner
+              << std::endl;
+
+    return result;
+}
+
+}   // namespace sat
+}   // namespace operations_research
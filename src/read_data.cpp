@@ -1,11 +1,19 @@
+#include <algorithm>
 #include <fstream>
+#include <set>
 
+#include "build_model.hpp"
+#include "calendar.hpp"
+#include "changeover.hpp"
 #include "read_data.hpp"
 #include "types.hpp"
 
 namespace operations_research {
 namespace sat {
 
+// the color, parent, left and right of a std::map node, before its value
+constexpr std::size_t MAP_NODE_OVERHEAD = 32;
+
 std::map<JobID, MachineID> read_dedicated_machine_data()
 {
     // Read the dedicated machine data from dedicated_machine.csv file, and
@@ -194,15 +202,16 @@ std::map<ReticleID, int> read_reticle_sharing_data()
     return reticle_sharing_data;
 }
 
-std::map<SetupPair, TimeDuration> read_setup_time_data()
+SetupFamilies read_setup_time_data()
 {
-    std::map<SetupPair, TimeDuration> setup_time_data;   // key: (machine_id, reticle_id,
-                                                         // reticle_id), value: setup_time
+    // the rows first, the reticle count sizes the matrices
+    std::vector<std::pair<SetupPair, TimeDuration>> setup_rows;   // ((machine_id, reticle_id,
+                                                                  // reticle_id), setup_time)
     std::ifstream setup_time_file;
     setup_time_file.open("data/setup_time.csv");
     if (!setup_time_file.is_open()) {
         std::cerr << "Unable to open setup_time.csv file" << std::endl;
-        return setup_time_data;
+        return SetupFamilies();
     }
 
     std::string line;
@@ -213,8 +222,8 @@ std::map<SetupPair, TimeDuration> read_setup_time_data()
         while (std::getline(line_stream, cell, ',')) {
             row.push_back(cell);
         }
-        if (row.size() < 2) {
-            std::cerr << "Invalid data format in dedicated_machine.csv file" << std::endl;
+        if (row.size() < 4) {
+            std::cerr << "Invalid data format in setup_time.csv file" << std::endl;
             continue;
         }
         try {
@@ -222,20 +231,50 @@ std::map<SetupPair, TimeDuration> read_setup_time_data()
             ReticleID    reticle_id_1 = std::stoi(row[1]);
             ReticleID    reticle_id_2 = std::stoi(row[2]);
             TimeDuration setup_time   = std::stoi(row[3]);
-            SetupPair    key          = std::make_tuple(machine_id, reticle_id_1, reticle_id_2);
-            setup_time_data[key]      = setup_time;
-            std::cout << "Machine ID: " << machine_id << " Reticle ID 1: " << reticle_id_1
-                      << " Reticle ID 2: " << reticle_id_2 << " Setup Time: " << setup_time
-                      << std::endl;
+            setup_rows.push_back({{machine_id, reticle_id_1, reticle_id_2}, setup_time});
         }
         catch (const std::invalid_argument& ia) {
-            std::cerr << "Invalid data in dedicated_machine.csv file: " << ia.what() << std::endl;
+            std::cerr << "Invalid data in setup_time.csv file: " << ia.what() << std::endl;
         }
     }
 
     setup_time_file.close();   // Close the file
 
-    return setup_time_data;
+    // one dense matrix per machine, deduplicated into the families of identical matrices
+    std::size_t num_reticles = 0;
+    for (const auto& [setup_pair, _] : setup_rows) {
+        const auto [machine_id, reticle_id_1, reticle_id_2] = setup_pair;
+        num_reticles =
+            std::max<std::size_t>(num_reticles, std::max(reticle_id_1, reticle_id_2) + 1);
+    }
+    std::stable_sort(setup_rows.begin(), setup_rows.end(), [](const auto& a, const auto& b) {
+        return std::get<0>(a.first) < std::get<0>(b.first);
+    });
+
+    SetupFamilies setup_families(num_reticles);
+    for (std::size_t begin = 0; begin < setup_rows.size();) {
+        const auto machine_id = std::get<0>(setup_rows[begin].first);
+
+        std::vector<TimeDuration> matrix(num_reticles * num_reticles, 0);
+        auto                      end = begin;
+        for (; end < setup_rows.size() and std::get<0>(setup_rows[end].first) == machine_id;
+             ++end) {
+            const auto [_, reticle_id_1, reticle_id_2] = setup_rows[end].first;
+            matrix[reticle_id_1 * num_reticles + reticle_id_2] = setup_rows[end].second;
+        }
+        setup_families.set_matrix(machine_id, std::move(matrix));
+        begin = end;
+    }
+
+    // the same setups as one map node per (machine, reticle, reticle)
+    const auto map_bytes = setup_rows.size() * (sizeof(std::pair<const SetupPair, TimeDuration>) +
+                                                MAP_NODE_OVERHEAD);
+    std::cout << "Setup times: " << setup_rows.size() << " entries, "
+              << setup_families.num_families() << " setup families, "
+              << (setup_families.bytes() >> 10) << " KB (map: " << (map_bytes >> 10) << " KB)"
+              << std::endl;
+
+    return setup_families;
 }
 
 std::map<MachinePair, TimeDuration> read_transfer_time_data()
@@ -394,5 +433,167 @@ std::map<JobID, ReticleID> read_job_reticle_pair_data()
     return job_reticle_data;
 }
 
+std::map<MachineID, std::vector<TimeWindow>> read_machine_calendar_data()
+{
+    // Read the unavailable windows of the machines from machine_calendar.csv file, one window per
+    // line: machine_id,start,end. the file is optional, the machines are always available without
+    // it
+    std::map<MachineID, std::vector<TimeWindow>> machine_calendar_data;
+    std::ifstream                                machine_calendar_file;
+    machine_calendar_file.open("data/machine_calendar.csv");
+    if (!machine_calendar_file.is_open()) {
+        std::cout << "No machine_calendar.csv file, the machines are always available"
+                  << std::endl;
+        return machine_calendar_data;
+    }
+
+    std::string line;
+    while (std::getline(machine_calendar_file, line)) {
+        std::stringstream        line_stream(line);
+        std::string              cell;
+        std::vector<std::string> row;
+        while (std::getline(line_stream, cell, ',')) {
+            row.push_back(cell);
+        }
+        if (row.size() < 3) {
+            std::cerr << "Invalid data format in machine_calendar.csv file" << std::endl;
+            continue;
+        }
+        try {
+            MachineID machine_id = std::stoi(row[0]);
+            TimeStamp start      = std::stoi(row[1]);
+            TimeStamp end        = std::stoi(row[2]);
+            machine_calendar_data[machine_id].push_back({start, end});
+        }
+        catch (const std::invalid_argument& ia) {
+            std::cerr << "Invalid data in machine_calendar.csv file: " << ia.what() << std::endl;
+        }
+    }
+
+    machine_calendar_file.close();   // Close the file
+
+    // shift or bucket calendars give many adjacent windows, keep them merged
+    for (auto& [machine_id, windows] : machine_calendar_data) {
+        windows = merge_time_windows(windows);
+        std::cout << "Machine ID: " << machine_id << " Downtime Windows: " << windows.size()
+                  << std::endl;
+    }
+
+    return machine_calendar_data;
+}
+
+std::map<JobID, RouteStep> read_lot_route_data()
+{
+    // Read the litho operations of the multi-visit lots from lot_routes.csv file, one operation
+    // per line: lot_id,layer,job_id,min_queue_time. the queue time is the minimum time between
+    // the end of the previous layer of the lot and the start of the operation. the file is
+    // optional, each job is a single operation lot without it
+    std::map<JobID, RouteStep> job_predecessors;
+    std::ifstream              lot_route_file;
+    lot_route_file.open("data/lot_routes.csv");
+    if (!lot_route_file.is_open()) {
+        std::cout << "No lot_routes.csv file, each job is a single operation lot" << std::endl;
+        return job_predecessors;
+    }
+
+    // key: lot_id, value: (job_id, min_queue_time) by layer
+    std::map<JobID, std::map<int, std::pair<JobID, TimeDuration>>> lot_routes;
+
+    std::string line;
+    while (std::getline(lot_route_file, line)) {
+        std::stringstream        line_stream(line);
+        std::string              cell;
+        std::vector<std::string> row;
+        while (std::getline(line_stream, cell, ',')) {
+            row.push_back(cell);
+        }
+        if (row.size() < 4) {
+            std::cerr << "Invalid data format in lot_routes.csv file" << std::endl;
+            continue;
+        }
+        try {
+            JobID        lot_id       = std::stoi(row[0]);
+            int          layer        = std::stoi(row[1]);
+            JobID        job_id       = std::stoi(row[2]);
+            TimeDuration queue_time   = std::stoi(row[3]);
+            lot_routes[lot_id][layer] = {job_id, queue_time};
+        }
+        catch (const std::invalid_argument& ia) {
+            std::cerr << "Invalid data in lot_routes.csv file: " << ia.what() << std::endl;
+        }
+    }
+
+    lot_route_file.close();   // Close the file
+
+    // chain the operations of each lot in layer order
+    for (const auto& [lot_id, layers] : lot_routes) {
+        const std::pair<JobID, TimeDuration>* previous = nullptr;
+        for (const auto& [layer, operation] : layers) {
+            if (previous != nullptr) {
+                job_predecessors[operation.first] = {previous->first, operation.second};
+            }
+            previous = &operation;
+        }
+        std::cout << "Lot ID: " << lot_id << " Operations: " << layers.size() << std::endl;
+    }
+
+    return job_predecessors;
+}
+
+std::map<JobID, RouteStep> restrict_lot_routes(const std::map<JobID, RouteStep>& job_predecessors,
+                                               const std::set<JobID>&            jobs)
+{
+    std::map<JobID, RouteStep> routes;
+    for (const auto& [job_id, step] : job_predecessors) {
+        if (!jobs.contains(job_id)) {
+            continue;
+        }
+        RouteStep route = step;
+        while (!jobs.contains(route.previous_job_id)) {
+            const auto previous = job_predecessors.find(route.previous_job_id);
+            if (previous == job_predecessors.end()) {
+                break;
+            }
+            route.previous_job_id = previous->second.previous_job_id;
+            route.min_queue_time += previous->second.min_queue_time;
+        }
+        if (jobs.contains(route.previous_job_id)) {
+            routes[job_id] = route;
+        }
+    }
+    return routes;
+}
+
+InstData read_inst_data(std::size_t max_task_setup_bytes)
+{
+    InstData inst_data;
+    inst_data.job_ded_machines       = read_dedicated_machine_data();
+    inst_data.job_release_times      = read_job_release_time_data();
+    inst_data.job_due_times          = read_job_due_time_data();
+    inst_data.job_reticle_pairs      = read_job_reticle_pair_data();
+    inst_data.setup_times            = read_setup_time_data();
+    inst_data.transfer_times         = read_transfer_time_data();
+    inst_data.reticle_sharing_limits = read_reticle_sharing_data();
+    inst_data.reticle_init_positions = read_reticle_init_positions_data();
+    inst_data.reticle_init_usage     = read_reticle_init_usage();
+    inst_data.machine_downtimes      = read_machine_calendar_data();
+    inst_data.job_predecessors       = read_lot_route_data();
+
+    auto all_task_ptime_map = read_job_processing_time_data();
+    filter_tasks(all_task_ptime_map, inst_data);
+
+    // an operation without task is not scheduled, the next layer of its lot waits for the layer
+    // before it
+    std::set<JobID> jobs;
+    for (const auto& [task_id, _] : inst_data.processing_times) {
+        jobs.insert(task_id.first);
+    }
+    inst_data.job_predecessors = restrict_lot_routes(inst_data.job_predecessors, jobs);
+
+    build_changeover_table(inst_data, max_task_setup_bytes);
+
+    return inst_data;
+}
+
 }   // namespace sat
 }   // namespace operations_research
\ No newline at end of file
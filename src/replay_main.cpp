@@ -0,0 +1,100 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "google/protobuf/text_format.h"
+#include "ortools/sat/cp_model.h"
+#include "ortools/sat/model.h"
+#include "ortools/sat/sat_parameters.pb.h"
+
+#include "model_dump.hpp"
+#include "solve_model.hpp"
+#include "types.hpp"
+
+// usage: litho_replay bundle.bin [--workers N[,N...]] [--time-limit T] [--seed S]
+//                     [--params "text format SatParameters"]
+// re-solve a model bundle written by litho_scheduling --dump, with the recorded parameters and
+// the given changes, once per worker count, and compare each run with the recorded solve
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        std::cerr << "usage: litho_replay bundle.bin [--workers N[,N...]] [--time-limit T] "
+                     "[--seed S] [--params \"...\"]"
+                  << std::endl;
+        return 1;
+    }
+
+    operations_research::sat::ModelBundle bundle;
+    if (!operations_research::sat::read_model_bundle(argv[1], bundle)) {
+        return 1;
+    }
+
+    std::vector<int> worker_counts;   // empty: the recorded one
+    int              time_limit  = 0;    // 0: the recorded one
+    int              random_seed = -1;   // -1: the recorded one
+    std::string      parameter_changes;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--workers" and i + 1 < argc) {
+            std::stringstream counts(argv[++i]);
+            std::string       count;
+            while (std::getline(counts, count, ',')) {
+                worker_counts.push_back(std::stoi(count));
+            }
+        }
+        else if (arg == "--time-limit" and i + 1 < argc) {
+            time_limit = std::stoi(argv[++i]);
+        }
+        else if (arg == "--seed" and i + 1 < argc) {
+            random_seed = std::stoi(argv[++i]);
+        }
+        else if (arg == "--params" and i + 1 < argc) {
+            parameter_changes = argv[++i];
+        }
+    }
+
+    // the model may come from other files than the current data folder
+    const auto input_hash = operations_research::sat::hash_input_files();
+    std::cout << "Input hash: " << std::hex << bundle.input_hash << std::dec
+              << (input_hash == bundle.input_hash ? " (same as data/)" : " (not data/)")
+              << std::endl;
+
+    auto parameters = bundle.parameters;
+    if (time_limit > 0) {
+        operations_research::sat::set_time_limit(parameters, time_limit);
+    }
+    if (random_seed >= 0) {
+        parameters.set_random_seed(random_seed);
+    }
+    if (!parameter_changes.empty() and
+        !google::protobuf::TextFormat::MergeFromString(parameter_changes, &parameters)) {
+        std::cerr << "Invalid parameters: " << parameter_changes << std::endl;
+        return 1;
+    }
+    // set_num_search_workers records the deprecated num_search_workers, num_workers is 0 then.
+    // without --workers the recorded parameters are kept as they are
+    const bool recorded_workers = worker_counts.empty();
+    if (recorded_workers) {
+        worker_counts.push_back(parameters.num_search_workers() > 0
+                                    ? parameters.num_search_workers()
+                                    : parameters.num_workers());
+    }
+
+    for (const auto num_workers : worker_counts) {
+        auto run_parameters = parameters;
+        if (!recorded_workers) {
+            operations_research::sat::set_num_search_workers(run_parameters, num_workers);
+        }
+
+        operations_research::sat::Model model;
+        operations_research::sat::add_parameters_to_model(model, run_parameters);
+        const auto response = operations_research::sat::solve_model(model, bundle.model);
+
+        operations_research::sat::print_replay_diff(
+            std::to_string(num_workers) + " workers", bundle.response, response);
+    }
+
+    return 0;
+}
@@ -0,0 +1,426 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <thread>
+
+#include "ortools/sat/cp_model.h"
+#include "ortools/sat/model.h"
+#include "ortools/sat/sat_parameters.pb.h"
+
+#include "build_model.hpp"
+#include "calendar.hpp"
+#include "changeover.hpp"
+#include "evaluator.hpp"
+#include "read_data.hpp"
+#include "scenario.hpp"
+#include "solve_model.hpp"
+#include "types.hpp"
+
+namespace operations_research {
+namespace sat {
+
+namespace {
+
+const std::map<std::string, DeltaType> DELTA_TYPES = {
+    {"machine_down", DeltaType::MachineDown},
+    {"release", DeltaType::ReleaseTime},
+    {"due", DeltaType::DueTime},
+    {"add_job", DeltaType::AddJob},
+    {"remove_job", DeltaType::RemoveJob},
+};
+
+ScenarioDelta parse_delta(DeltaType type, const std::vector<std::string>& row)
+{
+    // row: scenario, delta, arguments
+    const auto argument = [&](std::size_t i) -> TimeStamp {
+        if (i + 2 >= row.size()) {
+            throw std::invalid_argument("missing argument");
+        }
+        return std::stoi(row[i + 2]);
+    };
+
+    ScenarioDelta delta;
+    delta.type = type;
+    switch (type) {
+    case DeltaType::MachineDown:
+        delta.machine_id = argument(0);
+        if (row.size() > 3) {
+            delta.window = {argument(1), argument(2)};
+        }
+        break;
+    case DeltaType::ReleaseTime:
+    case DeltaType::DueTime:
+        delta.job_id = argument(0);
+        delta.time   = argument(1);
+        break;
+    case DeltaType::AddJob:
+        delta.job_id     = argument(0);
+        delta.reticle_id = argument(1);
+        delta.time       = argument(2);
+        delta.due_time   = argument(3);
+        for (std::size_t i = 4; i + 2 < row.size(); i += 2) {
+            delta.processing_times.push_back({argument(i), argument(i + 1)});
+        }
+        if (delta.processing_times.empty()) {
+            throw std::invalid_argument("added job without machine");
+        }
+        break;
+    case DeltaType::RemoveJob: delta.job_id = argument(0); break;
+    }
+    return delta;
+}
+
+void remove_job(InstData& inst_data, JobID job_id)
+{
+    inst_data.job_ded_machines.erase(job_id);
+    inst_data.job_release_times.erase(job_id);
+    inst_data.job_due_times.erase(job_id);
+    inst_data.job_reticle_pairs.erase(job_id);
+    std::erase_if(inst_data.processing_times,
+                  [&](const auto& entry) { return entry.first.first == job_id; });
+
+    // the next layer of its lot waits for the layer before it
+    std::set<JobID> jobs;
+    for (const auto& [task_id, _] : inst_data.processing_times) {
+        jobs.insert(task_id.first);
+    }
+    inst_data.job_predecessors = restrict_lot_routes(inst_data.job_predecessors, jobs);
+}
+
+// the jobs that have a task only on the machine
+std::set<JobID> find_machine_only_jobs(const InstData& inst_data, MachineID machine_id)
+{
+    std::map<JobID, int> num_other_machines;
+    for (const auto& [task_id, _] : inst_data.processing_times) {
+        num_other_machines[task_id.first] += task_id.second != machine_id ? 1 : 0;
+    }
+
+    std::set<JobID> jobs;
+    for (const auto& [job_id, num_machines] : num_other_machines) {
+        if (num_machines == 0) {
+            jobs.insert(job_id);
+        }
+    }
+    return jobs;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start_time)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+void set_kpis(ScenarioKpis& kpis, const CpSolverResponse& response, const TaskVars& task_vars,
+              const InstData& inst_data, const std::map<JobID, TimeStamp>& release_times,
+              const std::map<JobID, TimeStamp>& due_times)
+{
+    kpis.status = response.status();
+    if (response.status() != CpSolverStatus::OPTIMAL and
+        response.status() != CpSolverStatus::FEASIBLE) {
+        return;
+    }
+
+    const auto evaluation = evaluate_schedule(
+        extract_schedule(response, task_vars, inst_data), inst_data, release_times, due_times);
+    kpis.feasible        = evaluation.feasible();
+    kpis.objective       = evaluation.objective;
+    kpis.makespan        = evaluation.makespan;
+    kpis.total_tardiness = evaluation.total_tardiness;
+    kpis.total_setup     = evaluation.total_setup;
+    kpis.num_setups      = evaluation.num_setups;
+    kpis.total_transfer  = evaluation.total_transfer;
+    kpis.num_transfers   = evaluation.num_transfers;
+}
+
+}   // namespace
+
+std::vector<Scenario> read_scenarios(const std::string& file_name)
+{
+    std::vector<Scenario> scenarios;
+    std::ifstream         scenario_file;
+    scenario_file.open(file_name);
+    if (!scenario_file.is_open()) {
+        std::cerr << "Unable to open " << file_name << " file" << std::endl;
+        return scenarios;
+    }
+
+    std::map<std::string, std::size_t> scenario_indices;   // in the order of first appearance
+    std::string                        line;
+    while (std::getline(scenario_file, line)) {
+        if (line.empty() or line[0] == '#') {
+            continue;
+        }
+        std::stringstream        line_stream(line);
+        std::string              cell;
+        std::vector<std::string> row;
+        while (std::getline(line_stream, cell, ',')) {
+            row.push_back(cell);
+        }
+        if (row.size() < 3 or !DELTA_TYPES.contains(row[1])) {
+            std::cerr << "Invalid data format in " << file_name << " file: " << line << std::endl;
+            continue;
+        }
+        try {
+            const auto delta = parse_delta(DELTA_TYPES.at(row[1]), row);
+            if (!scenario_indices.contains(row[0])) {
+                scenario_indices[row[0]] = scenarios.size();
+                scenarios.push_back({row[0], {}});
+            }
+            scenarios[scenario_indices.at(row[0])].deltas.push_back(delta);
+        }
+        catch (const std::invalid_argument& ia) {
+            std::cerr << "Invalid data in " << file_name << " file: " << ia.what() << ": " << line
+                      << std::endl;
+        }
+    }
+
+    scenario_file.close();
+
+    return scenarios;
+}
+
+InstData apply_scenario(const InstData& base_data, const Scenario& scenario, int& dropped_jobs)
+{
+    InstData inst_data     = base_data;
+    bool     tasks_changed = false;
+    dropped_jobs           = 0;
+
+    for (const auto& delta : scenario.deltas) {
+        switch (delta.type) {
+        case DeltaType::MachineDown:
+            if (delta.window != TimeWindow{0, 0}) {
+                auto& windows = inst_data.machine_downtimes[delta.machine_id];
+                windows.push_back(delta.window);
+                windows = merge_time_windows(windows);
+                break;
+            }
+            // down for the whole horizon: the jobs move to their other machines
+            for (const auto job_id : find_machine_only_jobs(inst_data, delta.machine_id)) {
+                remove_job(inst_data, job_id);
+                dropped_jobs++;
+            }
+            std::erase_if(inst_data.processing_times, [&](const auto& entry) {
+                return entry.first.second == delta.machine_id;
+            });
+            tasks_changed = true;
+            break;
+        case DeltaType::ReleaseTime:
+            if (inst_data.job_release_times.contains(delta.job_id)) {
+                inst_data.job_release_times[delta.job_id] = delta.time;
+            }
+            break;
+        case DeltaType::DueTime:
+            if (inst_data.job_due_times.contains(delta.job_id)) {
+                inst_data.job_due_times[delta.job_id] = delta.time;
+            }
+            break;
+        case DeltaType::AddJob:
+            // the reticle should be known, its sharing limit and initial position are needed
+            if (!inst_data.reticle_sharing_limits.contains(delta.reticle_id) or
+                !inst_data.reticle_init_positions.contains(delta.reticle_id)) {
+                std::cerr << "Scenario " << scenario.name << ": unknown reticle "
+                          << delta.reticle_id << " of job " << delta.job_id << std::endl;
+                break;
+            }
+            remove_job(inst_data, delta.job_id);
+            inst_data.job_release_times[delta.job_id] = delta.time;
+            inst_data.job_due_times[delta.job_id]     = delta.due_time;
+            inst_data.job_reticle_pairs[delta.job_id] = delta.reticle_id;
+            for (const auto& [machine_id, processing_time] : delta.processing_times) {
+                inst_data.processing_times[{delta.job_id, machine_id}] = processing_time;
+            }
+            tasks_changed = true;
+            break;
+        case DeltaType::RemoveJob:
+            remove_job(inst_data, delta.job_id);
+            tasks_changed = true;
+            break;
+        }
+    }
+
+    if (tasks_changed) {
+        build_changeover_table(inst_data);
+    }
+
+    return inst_data;
+}
+
+bool is_patchable(const InstData& base_data, const TaskVars& base_task_vars,
+                  const Scenario& scenario)
+{
+    std::set<MachineID> down_machines;
+    for (const auto& delta : scenario.deltas) {
+        switch (delta.type) {
+        case DeltaType::ReleaseTime:
+        case DeltaType::DueTime: break;
+        case DeltaType::MachineDown:
+            // a downtime window changes the start domains and the horizon
+            if (delta.window != TimeWindow{0, 0}) {
+                return false;
+            }
+            // without the depot loop the emptied machine circuit is infeasible
+            if (!base_task_vars.machine_empty_vars.contains(delta.machine_id)) {
+                return false;
+            }
+            down_machines.insert(delta.machine_id);
+            break;
+        default: return false;
+        }
+    }
+
+    // every job keeps a machine, the absent tasks of the dropped jobs would make it infeasible
+    std::set<JobID> jobs, kept_jobs;
+    for (const auto& [task_id, _] : base_data.processing_times) {
+        jobs.insert(task_id.first);
+        if (!down_machines.contains(task_id.second)) {
+            kept_jobs.insert(task_id.first);
+        }
+    }
+    return kept_jobs.size() == jobs.size();
+}
+
+std::vector<ScenarioKpis> run_scenarios(const InstData& base_data,
+                                        const std::vector<Scenario>& scenarios, int num_threads,
+                                        int time_limit, int min_workers)
+{
+    // the base instance is solved as a scenario without deltas
+    std::vector<Scenario> all_scenarios = {{"base", {}}};
+    all_scenarios.insert(all_scenarios.end(), scenarios.begin(), scenarios.end());
+
+    // the base model, patched by the scenarios that only change times or availabilities
+    CpModelBuilder      base_model;
+    TaskVars            base_task_vars;
+    ModelIndex          base_model_index;
+    std::vector<IntVar> base_obj_exprs;
+    build_model(base_model, base_task_vars, base_model_index, base_obj_exprs, base_data,
+                BuildOptions());
+    const auto& base_proto = base_model.Build();
+
+    const int num_scenarios = all_scenarios.size();
+    const int num_slots = std::clamp(num_threads / std::max(1, min_workers), 1, num_scenarios);
+    const int num_workers = std::max(1, num_threads / num_slots);
+    std::cout << "Scenarios: " << all_scenarios.size() << ", " << num_slots
+              << " concurrent solves with " << num_workers << " workers" << std::endl;
+
+    std::vector<ScenarioKpis> rows(all_scenarios.size());
+    std::atomic<std::size_t>  next = 0;
+    std::vector<std::thread>  slots;
+    for (int slot = 0; slot < num_slots; ++slot) {
+        slots.emplace_back([&] {
+            for (auto i = next++; i < all_scenarios.size(); i = next++) {
+                const auto& scenario   = all_scenarios[i];
+                const auto  start_time = std::chrono::steady_clock::now();
+                auto&       kpis       = rows[i];
+                kpis.name              = scenario.name;
+
+                Model         model;
+                SatParameters parameters;
+                set_time_limit(parameters, time_limit);
+                set_num_search_workers(parameters, num_workers);
+                disable_log_search_progress(parameters);
+                add_parameters_to_model(model, parameters);
+
+                // a patched scenario works on the base instance with its own times, only the
+                // rebuilt ones copy the instance
+                if (is_patchable(base_data, base_task_vars, scenario)) {
+                    kpis.patched               = true;
+                    CpModelProto model_proto   = base_proto;
+                    auto         release_times = base_data.job_release_times;
+                    auto         due_times     = base_data.job_due_times;
+                    for (const auto& delta : scenario.deltas) {
+                        if (delta.type == DeltaType::ReleaseTime) {
+                            patch_job_release_time(
+                                model_proto, base_model_index, delta.job_id, delta.time);
+                            if (release_times.contains(delta.job_id)) {
+                                release_times[delta.job_id] = delta.time;
+                            }
+                        }
+                        else if (delta.type == DeltaType::DueTime) {
+                            patch_job_due_time(
+                                model_proto, base_model_index, delta.job_id, delta.time);
+                            if (due_times.contains(delta.job_id)) {
+                                due_times[delta.job_id] = delta.time;
+                            }
+                        }
+                        else {
+                            patch_machine_availability(
+                                model_proto, base_task_vars, delta.machine_id, false);
+                        }
+                    }
+                    const auto response = solve_model(model, model_proto);
+                    set_kpis(kpis, response, base_task_vars, base_data, release_times, due_times);
+                }
+                else {
+                    const auto inst_data = apply_scenario(base_data, scenario, kpis.dropped_jobs);
+
+                    CpModelBuilder      cp_model;
+                    TaskVars            task_vars;
+                    ModelIndex          model_index;
+                    std::vector<IntVar> obj_exprs;
+                    build_model(
+                        cp_model, task_vars, model_index, obj_exprs, inst_data, BuildOptions());
+                    const auto response = solve_model(model, cp_model);
+                    set_kpis(kpis,
+                             response,
+                             task_vars,
+                             inst_data,
+                             inst_data.job_release_times,
+                             inst_data.job_due_times);
+                }
+
+                kpis.wall_time = seconds_since(start_time);
+            }
+        });
+    }
+    for (auto& slot : slots) {
+        slot.join();
+    }
+
+    return rows;
+}
+
+void print_scenario_table(const std::vector<ScenarioKpis>& rows)
+{
+    std::cout << std::left << std::setw(20) << "scenario" << std::setw(12) << "status"
+              << std::setw(8) << "model" << std::setw(11) << "objective" << std::setw(10)
+              << "makespan" << std::setw(11) << "tardiness" << std::setw(14) << "setups"
+              << std::setw(14) << "transfers" << std::setw(9) << "dropped" << "wall time (s)"
+              << std::endl;
+    for (const auto& row : rows) {
+        std::cout << std::left << std::setw(20) << row.name << std::setw(12)
+                  << CpSolverStatus_Name(row.status) << std::setw(8)
+                  << (row.patched ? "patched" : "rebuilt") << std::setw(11)
+                  << (row.feasible ? std::to_string(row.objective) : "-") << std::setw(10)
+                  << row.makespan << std::setw(11) << row.total_tardiness << std::setw(14)
+                  << std::format("{} ({})", row.total_setup, row.num_setups) << std::setw(14)
+                  << std::format("{} ({})", row.total_transfer, row.num_transfers)
+                  << std::setw(9) << row.dropped_jobs << std::fixed << std::setprecision(3)
+                  << row.wall_time << std::endl;
+    }
+}
+
+void write_scenario_table(const std::vector<ScenarioKpis>& rows, const std::string& file_name)
+{
+    std::ofstream table_file;
+    table_file.open(file_name);
+    table_file << "Scenario,Status,Model,Feasible,Objective,Makespan,Tardiness,Setup,Setups,"
+                  "Transfer,Transfers,Dropped_jobs,Wall_time\n";
+    for (const auto& row : rows) {
+        table_file << row.name << "," << CpSolverStatus_Name(row.status) << ","
+                   << (row.patched ? "patched" : "rebuilt") << "," << row.feasible << ","
+                   << row.objective << "," << row.makespan << "," << row.total_tardiness << ","
+                   << row.total_setup << "," << row.num_setups << "," << row.total_transfer
+                   << "," << row.num_transfers << "," << row.dropped_jobs << ","
+                   << row.wall_time << "\n";
+    }
+    table_file.close();
+}
+
+}   // namespace sat
+}   // namespace operations_research
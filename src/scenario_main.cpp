@@ -0,0 +1,30 @@
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "read_data.hpp"
+#include "scenario.hpp"
+#include "types.hpp"
+
+// usage: litho_scenarios [scenarios.csv] [time_limit] [threads]
+// solve the instance under data folder and its scenario variants concurrently, and compare their
+// KPIs. the table is also written to data/scenario_kpis.csv
+int main(int argc, char** argv)
+{
+    std::string file_name   = argc > 1 ? argv[1] : "data/scenarios.csv";
+    int         time_limit  = argc > 2 ? std::stoi(argv[2]) : 60;
+    int         num_threads = argc > 3 ? std::stoi(argv[3])
+                                       : std::max(1u, std::thread::hardware_concurrency());
+
+    const auto inst_data = operations_research::sat::read_inst_data();
+    const auto scenarios = operations_research::sat::read_scenarios(file_name);
+
+    const auto rows =
+        operations_research::sat::run_scenarios(inst_data, scenarios, num_threads, time_limit);
+
+    operations_research::sat::print_scenario_table(rows);
+    operations_research::sat::write_scenario_table(rows, "data/scenario_kpis.csv");
+
+    return 0;
+}
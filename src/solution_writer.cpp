@@ -0,0 +1,392 @@
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+#include "ortools/sat/cp_model.h"
+
+#include "solution_writer.hpp"
+#include "types.hpp"
+
+namespace operations_research {
+namespace sat {
+
+namespace {
+
+// column names of sol.csv, all columns are int32
+constexpr const char* COLUMNS[] = {"Job",
+                                   "Machine",
+                                   "Reticle",
+                                   "Transfer",
+                                   "Setup",
+                                   "Start",
+                                   "Processing",
+                                   "End",
+                                   "Position",
+                                   "Reticle_usage"};
+
+// const or mutable pointers to the columns, in the order of COLUMNS
+template <typename Columns>
+std::vector<decltype(&std::declval<Columns&>().job_id)> column_data(Columns& columns)
+{
+    return {&columns.job_id,
+            &columns.machine_id,
+            &columns.reticle_id,
+            &columns.transfer,
+            &columns.setup,
+            &columns.start,
+            &columns.processing,
+            &columns.end,
+            &columns.position,
+            &columns.reticle_usage};
+}
+
+void write_file(const std::string& file_name, const std::string& content)
+{
+    const auto    temp_name = file_name + ".tmp";
+    std::ofstream file(temp_name, std::ios::binary);
+    file.write(content.data(), content.size());
+    file.close();
+    if (!file or std::rename(temp_name.c_str(), file_name.c_str()) != 0) {
+        std::cerr << "Unable to write " << file_name << std::endl;
+    }
+}
+
+// minimal flatbuffers builder for the Arrow IPC metadata. the buffer is built back to front, an
+// object is referred to by its distance from the end of the buffer
+class FlatBufferBuilder
+{
+public:
+    using Ref = uint32_t;
+
+    // pad so that the buffer is aligned once size bytes are prepended
+    void align(std::size_t size, std::size_t alignment)
+    {
+        max_alignment_ = std::max(max_alignment_, alignment);
+        while ((bytes_.size() + size) % alignment != 0) {
+            bytes_.push_front(0);
+        }
+    }
+
+    template <typename T>
+    void prepend(T value)
+    {
+        align(sizeof(T), sizeof(T));
+        uint8_t raw[sizeof(T)];
+        std::memcpy(raw, &value, sizeof(T));   // little endian
+        bytes_.insert(bytes_.begin(), raw, raw + sizeof(T));
+    }
+
+    void prepend_offset(Ref ref)
+    {
+        align(sizeof(uint32_t), sizeof(uint32_t));
+        prepend<uint32_t>(bytes_.size() + sizeof(uint32_t) - ref);
+    }
+
+    Ref create_string(const std::string& value)
+    {
+        align(value.size() + 1, sizeof(uint32_t));
+        bytes_.push_front(0);
+        bytes_.insert(bytes_.begin(), value.begin(), value.end());
+        prepend<uint32_t>(value.size());
+        return bytes_.size();
+    }
+
+    Ref create_offset_vector(const std::vector<Ref>& refs)
+    {
+        align(refs.size() * sizeof(uint32_t), sizeof(uint32_t));
+        for (auto it = refs.rbegin(); it != refs.rend(); ++it) {
+            prepend_offset(*it);
+        }
+        prepend<uint32_t>(refs.size());
+        return bytes_.size();
+    }
+
+    // structs of 8 byte aligned int64 fields
+    Ref create_struct_vector(const std::vector<int64_t>& values, std::size_t struct_size)
+    {
+        align(values.size() * sizeof(int64_t), sizeof(int64_t));
+        for (auto it = values.rbegin(); it != values.rend(); ++it) {
+            prepend<int64_t>(*it);
+        }
+        prepend<uint32_t>(values.size() * sizeof(int64_t) / struct_size);
+        return bytes_.size();
+    }
+
+    void start_table()
+    {
+        table_start_ = bytes_.size();
+        fields_.clear();
+    }
+
+    template <typename T>
+    void add_field(int id, T value)
+    {
+        prepend<T>(value);
+        fields_.push_back({id, static_cast<Ref>(bytes_.size())});
+    }
+
+    void add_offset_field(int id, Ref ref)
+    {
+        prepend_offset(ref);
+        fields_.push_back({id, static_cast<Ref>(bytes_.size())});
+    }
+
+    Ref end_table()
+    {
+        prepend<int32_t>(0);   // offset to the vtable, set below
+        const Ref table = bytes_.size();
+
+        int num_ids = 0;
+        for (const auto& [id, _] : fields_) {
+            num_ids = std::max(num_ids, id + 1);
+        }
+        std::vector<uint16_t> field_offsets(num_ids, 0);
+        for (const auto& [id, ref] : fields_) {
+            field_offsets[id] = table - ref;
+        }
+
+        // vtable: vtable size, table size, offset of each field in the table
+        for (auto it = field_offsets.rbegin(); it != field_offsets.rend(); ++it) {
+            prepend<uint16_t>(*it);
+        }
+        prepend<uint16_t>(table - table_start_);
+        prepend<uint16_t>(sizeof(uint16_t) * (2 + num_ids));
+        const Ref vtable = bytes_.size();
+
+        // the vtable is before the table: vtable = table - soffset
+        const int32_t soffset = vtable - table;
+        uint8_t       raw[sizeof(int32_t)];
+        std::memcpy(raw, &soffset, sizeof(int32_t));
+        std::copy(raw, raw + sizeof(int32_t), bytes_.end() - table);
+
+        return table;
+    }
+
+    std::string finish(Ref root)
+    {
+        align(sizeof(uint32_t), max_alignment_);
+        prepend_offset(root);
+        return std::string(bytes_.begin(), bytes_.end());
+    }
+
+private:
+    std::deque<uint8_t>             bytes_;
+    std::size_t                     max_alignment_ = 1;
+    Ref                             table_start_   = 0;
+    std::vector<std::pair<int, Ref>> fields_;
+};
+
+// Arrow format enums (Schema.fbs, Message.fbs)
+constexpr int16_t METADATA_V5         = 4;
+constexpr uint8_t HEADER_SCHEMA       = 1;
+constexpr uint8_t HEADER_RECORD_BATCH = 3;
+constexpr uint8_t TYPE_INT            = 2;
+constexpr int16_t ENDIANNESS_LITTLE   = 0;
+constexpr int     CONTINUATION_MARKER = -1;
+
+FlatBufferBuilder::Ref build_schema(FlatBufferBuilder& builder)
+{
+    std::vector<FlatBufferBuilder::Ref> fields;
+    for (const auto* name : COLUMNS) {
+        const auto name_ref = builder.create_string(name);
+
+        builder.start_table();   // Int
+        builder.add_field<int32_t>(0, 32);
+        builder.add_field<uint8_t>(1, true);   // signed
+        const auto type_ref = builder.end_table();
+
+        const auto children_ref = builder.create_offset_vector({});
+
+        builder.start_table();   // Field
+        builder.add_offset_field(0, name_ref);
+        builder.add_field<uint8_t>(1, false);   // nullable
+        builder.add_field<uint8_t>(2, TYPE_INT);
+        builder.add_offset_field(3, type_ref);
+        builder.add_offset_field(5, children_ref);
+        fields.push_back(builder.end_table());
+    }
+    const auto fields_ref = builder.create_offset_vector(fields);
+
+    builder.start_table();   // Schema
+    builder.add_field<int16_t>(0, ENDIANNESS_LITTLE);
+    builder.add_offset_field(1, fields_ref);
+    return builder.end_table();
+}
+
+std::string build_message(uint8_t header_type, FlatBufferBuilder& builder,
+                          FlatBufferBuilder::Ref header, int64_t body_length)
+{
+    builder.start_table();   // Message
+    builder.add_field<int16_t>(0, METADATA_V5);
+    builder.add_field<uint8_t>(1, header_type);
+    builder.add_offset_field(2, header);
+    builder.add_field<int64_t>(3, body_length);
+    return builder.finish(builder.end_table());
+}
+
+template <typename T>
+void append_value(std::string& out, T value)
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void pad_to_8(std::string& out)
+{
+    out.append((8 - out.size() % 8) % 8, '\0');
+}
+
+// continuation marker, metadata size, metadata padded to 8 bytes, body. returns the metadata
+// length of the footer block
+int32_t append_message(std::string& out, std::string metadata, const std::string& body)
+{
+    pad_to_8(metadata);
+    append_value<int32_t>(out, CONTINUATION_MARKER);
+    append_value<int32_t>(out, metadata.size());
+    out += metadata;
+    out += body;
+    return 2 * sizeof(int32_t) + metadata.size();
+}
+
+}   // namespace
+
+SolutionExporter::SolutionExporter(const TaskVars& task_vars, const InstData& inst_data)
+{
+    for (const auto& [task_id, presence_var] : task_vars.task_presence_vars) {
+        const auto [job_id, machine_id] = task_id;
+        tasks_.push_back({presence_var.index(),
+                          task_vars.task_transfer_vars.at(task_id).index(),
+                          task_vars.task_setup_vars.at(task_id).index(),
+                          task_vars.task_start_vars.at(task_id).index(),
+                          task_vars.task_end_vars.at(task_id).index(),
+                          task_vars.task_position_vars.at(task_id).index(),
+                          task_vars.reticle_sharing_vars.at(task_id).index(),
+                          static_cast<int32_t>(job_id),
+                          static_cast<int32_t>(machine_id),
+                          static_cast<int32_t>(inst_data.job_reticle_pairs.at(job_id)),
+                          static_cast<int32_t>(inst_data.processing_times.at(task_id))});
+    }
+}
+
+const ScheduleColumns& SolutionExporter::extract(const CpSolverResponse& response)
+{
+    for (auto* column : column_data(columns_)) {
+        column->clear();
+    }
+
+    const auto& values = response.solution();
+    for (const auto& task : tasks_) {
+        if (values[task.presence] == 0) {
+            continue;
+        }
+        columns_.job_id.push_back(task.job_id);
+        columns_.machine_id.push_back(task.machine_id);
+        columns_.reticle_id.push_back(task.reticle_id);
+        columns_.transfer.push_back(values[task.transfer]);
+        columns_.setup.push_back(values[task.setup]);
+        columns_.start.push_back(values[task.start]);
+        columns_.processing.push_back(task.processing);
+        columns_.end.push_back(values[task.end]);
+        columns_.position.push_back(values[task.position]);
+        columns_.reticle_usage.push_back(values[task.sharing]);
+    }
+
+    return columns_;
+}
+
+void SolutionExporter::write_csv(const std::string& file_name) const
+{
+    std::string out = "Job,Machine,Reticle,Transfer,Setup,Start,Processing,End,"
+                      "Position,Reticle_usage\n";
+
+    const auto columns = column_data(columns_);
+    out.reserve(out.size() + columns_.size() * columns.size() * 8);
+    char buffer[16];
+    for (std::size_t row = 0; row < columns_.size(); ++row) {
+        for (std::size_t column = 0; column < columns.size(); ++column) {
+            const auto value  = (*columns[column])[row];
+            const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            out.append(buffer, result.ptr);
+            out += column + 1 < columns.size() ? ',' : '\n';
+        }
+    }
+
+    write_file(file_name, out);
+}
+
+void SolutionExporter::write_arrow(const std::string& file_name) const
+{
+    const auto    columns  = column_data(columns_);
+    const int64_t num_rows = columns_.size();
+
+    std::string out = "ARROW1";
+    pad_to_8(out);
+
+    // schema message
+    std::vector<int64_t> blocks;   // Block structs: offset, metadata length, body length
+    {
+        FlatBufferBuilder builder;
+        const auto        schema = build_schema(builder);
+        append_message(out, build_message(HEADER_SCHEMA, builder, schema, 0), "");
+    }
+
+    // one record batch: a validity buffer of length 0 (no nulls) and a data buffer per column
+    std::string          body;
+    std::vector<int64_t> nodes, buffers;
+    for (const auto* column : columns) {
+        nodes.push_back(num_rows);
+        nodes.push_back(0);
+        buffers.push_back(body.size());
+        buffers.push_back(0);
+        buffers.push_back(body.size());
+        buffers.push_back(num_rows * sizeof(int32_t));
+        body.append(reinterpret_cast<const char*>(column->data()), num_rows * sizeof(int32_t));
+        pad_to_8(body);
+    }
+    {
+        FlatBufferBuilder builder;
+        const auto        nodes_ref   = builder.create_struct_vector(nodes, 16);
+        const auto        buffers_ref = builder.create_struct_vector(buffers, 16);
+        builder.start_table();   // RecordBatch
+        builder.add_field<int64_t>(0, num_rows);
+        builder.add_offset_field(1, nodes_ref);
+        builder.add_offset_field(2, buffers_ref);
+        const auto record_batch = builder.end_table();
+
+        const int64_t offset = out.size();
+        const auto    metadata =
+            build_message(HEADER_RECORD_BATCH, builder, record_batch, body.size());
+        const auto    metadata_length = append_message(out, metadata, body);
+        blocks.push_back(offset);
+        blocks.push_back(metadata_length);   // int32 and 4 bytes padding
+        blocks.push_back(body.size());
+    }
+
+    // end of stream, footer, footer size, magic
+    append_value<int32_t>(out, CONTINUATION_MARKER);
+    append_value<int32_t>(out, 0);
+    {
+        FlatBufferBuilder builder;
+        const auto        schema         = build_schema(builder);
+        const auto        dictionaries   = builder.create_struct_vector({}, 24);
+        const auto        record_batches = builder.create_struct_vector(blocks, 24);
+        builder.start_table();   // Footer
+        builder.add_field<int16_t>(0, METADATA_V5);
+        builder.add_offset_field(1, schema);
+        builder.add_offset_field(2, dictionaries);
+        builder.add_offset_field(3, record_batches);
+        const auto footer = builder.finish(builder.end_table());
+        out += footer;
+        append_value<int32_t>(out, footer.size());
+    }
+    out += "ARROW1";
+
+    write_file(file_name, out);
+}
+
+}   // namespace sat
+}   // namespace operations_research
@@ -30,14 +30,93 @@ void add_parameters_to_model(Model& model, SatParameters& parameters)
     model.Add(NewSatParameters(parameters));
 }
 
+void set_deterministic_mode(SatParameters& parameters, int random_seed,
+                            double deterministic_time_limit)
+{
+    parameters.set_random_seed(random_seed);
+    parameters.set_interleave_search(true);
+    parameters.set_max_deterministic_time(deterministic_time_limit);
+    // follow the decision strategy of the model, without it the strategy is only a hint. with
+    // several workers only the default worker follows it, the others keep their own branching
+    parameters.set_search_branching(SatParameters::FIXED_SEARCH);
+    // a wall time limit would stop the search at a different point in each run
+    parameters.clear_max_time_in_seconds();
+}
+
+void print_parameters(const SatParameters& parameters)
+{
+    std::cout << "Parameters: " << parameters.ShortDebugString() << std::endl;
+
+    std::ofstream params_file;
+    params_file.open("data/sol_params.txt");
+    params_file << parameters.DebugString();
+    params_file.close();
+}
+
 CpSolverResponse solve_model(Model& model, CpModelBuilder& cp_model)
 {
+    // the proto of the builder by reference, it is not copied before the solve
+    CpSolverResponse response = SolveCpModel(cp_model.Proto(), &model);
 
-    CpSolverResponse response = SolveCpModel(cp_model.Build(), &model);
+    return response;
+}
+
+CpSolverResponse solve_model(Model& model, const CpModelProto& model_proto)
+{
+    CpSolverResponse response = SolveCpModel(model_proto, &model);
 
     return response;
 }
 
+void patch_job_release_time(CpModelProto& model_proto, const ModelIndex& model_index,
+                            JobID job_id, TimeStamp release_time)
+{
+    // the release constraint is job_start >= release_time, i.e. a single term linear constraint
+    // with the domain [release_time, +inf)
+    const auto ct_index = model_index.job_release_constraints.at(job_id);
+    model_proto.mutable_constraints(ct_index)->mutable_linear()->set_domain(0, release_time);
+}
+
+void patch_job_due_time(CpModelProto& model_proto, const ModelIndex& model_index, JobID job_id,
+                        TimeStamp due_time)
+{
+    // the tardiness constraint is tardiness = max(0, job_end - due_time), the due time is the
+    // offset of the second expression
+    const auto ct_index = model_index.job_tardiness_constraints.at(job_id);
+    model_proto.mutable_constraints(ct_index)->mutable_lin_max()->mutable_exprs(1)->set_offset(
+        -static_cast<int64_t>(due_time));
+}
+
+void patch_task_availability(CpModelProto& model_proto, const TaskVars& task_vars,
+                             TaskID task_id, bool available)
+{
+    // an unavailable task is fixed to absent, the job must then use another alternative
+    const auto var_index = task_vars.task_presence_vars.at(task_id).index();
+    auto*      domain    = model_proto.mutable_variables(var_index)->mutable_domain();
+    domain->Clear();
+    domain->Add(0);
+    domain->Add(available ? 1 : 0);
+}
+
+void patch_machine_availability(CpModelProto& model_proto, const TaskVars& task_vars,
+                                MachineID machine_id, bool available)
+{
+    for (const auto& [task_id, _] : task_vars.task_presence_vars) {
+        if (task_id.second == machine_id) {
+            patch_task_availability(model_proto, task_vars, task_id, available);
+        }
+    }
+
+    // an unavailable machine is empty, its circuit closes with the depot loop
+    const auto empty_var = task_vars.machine_empty_vars.find(machine_id);
+    if (empty_var != task_vars.machine_empty_vars.end()) {
+        auto* domain = model_proto.mutable_variables(empty_var->second.index())->mutable_domain();
+        domain->Clear();
+        domain->Add(available ? 0 : 1);
+        domain->Add(1);
+    }
+}
+
 void print_obj_val(const CpSolverResponse& response)
 {
     if (response.status() == CpSolverStatus::OPTIMAL) {
@@ -72,13 +151,38 @@ void print_response_statistics(const CpSolverResponse& response)
     std::cout << CpSolverResponseStats(response) << std::endl;
 }
 
-void print_solution(const CpSolverResponse& response, const TaskVars& task_vars,
-                    const InstData& inst_data)
-
+Schedule extract_schedule(const CpSolverResponse& response, const TaskVars& task_vars,
+                          const InstData& inst_data)
 {
-    // write to the sol.csv file under data folder
+    Schedule schedule;
 
+    for (const auto& [task_id, task_presence_var] : task_vars.task_presence_vars) {
+        auto [job_id, machine_id] = task_id;
+        if (!SolutionBooleanValue(response, task_presence_var)) {
+            continue;
+        }
+
+        ScheduledTask task;
+        task.job_id     = job_id;
+        task.machine_id = machine_id;
+        task.reticle_id = inst_data.job_reticle_pairs.at(job_id);
+        task.transfer   = SolutionIntegerValue(response, task_vars.task_transfer_vars.at(task_id));
+        task.setup      = SolutionIntegerValue(response, task_vars.task_setup_vars.at(task_id));
+        task.start      = SolutionIntegerValue(response, task_vars.task_start_vars.at(task_id));
+        task.processing = inst_data.processing_times.at(task_id);
+        task.end        = SolutionIntegerValue(response, task_vars.task_end_vars.at(task_id));
+        task.position   = SolutionIntegerValue(response, task_vars.task_position_vars.at(task_id));
+        task.reticle_usage =
+            SolutionIntegerValue(response, task_vars.reticle_sharing_vars.at(task_id));
+        schedule.push_back(task);
+    }
 
+    return schedule;
+}
+
+void print_schedule(const Schedule& schedule)
+{
+    // write to the sol.csv file under data folder
     std::ofstream sol_file;
     sol_file.open("data/sol.csv");
 
@@ -88,48 +192,43 @@ void print_solution(const CpSolverResponse& response, const TaskVars& task_vars,
 
     std::cout << "print solutions ... \n";
 
-    for (const auto& [task_id, task_presence_var] : task_vars.task_presence_vars) {
-        auto [job_id, machine_id] = task_id;
-        if (SolutionBooleanValue(response, task_presence_var)) {
-            auto reticle_id = inst_data.job_reticle_pairs.at(job_id);
-            auto transfer_time =
-                SolutionIntegerValue(response, task_vars.task_transfer_vars.at(task_id));
-            auto setup_time = SolutionIntegerValue(response, task_vars.task_setup_vars.at(task_id));
-            auto start_time = SolutionIntegerValue(response, task_vars.task_start_vars.at(task_id));
-            auto end_time   = SolutionIntegerValue(response, task_vars.task_end_vars.at(task_id));
-            auto processing_time = inst_data.processing_times.at(task_id);
-
-            if (end_time - start_time != processing_time) {
-                std::cout << "Error: processing time is not equal to the duration\n";
-                std::cout << "processing time: " << processing_time << std::endl;
-                std::cout << "start time: " << start_time << std::endl;
-                std::cout << "end time: " << end_time << std::endl;
-            }
-
-            auto task_position =
-                SolutionIntegerValue(response, task_vars.task_position_vars.at(task_id));
-            auto reticle_sharing =
-                SolutionIntegerValue(response, task_vars.reticle_sharing_vars.at(task_id));
-
-            std::cout << "Job " << job_id << " is processed on machine " << machine_id;
-            std::cout << " with reticle " << reticle_id;
-            std::cout << " with transfer time: " << transfer_time;
-            std::cout << ", setup time: " << setup_time;
-            std::cout << ", start time: " << start_time;
-            std::cout << ", duration: " << processing_time;
-            std::cout << ", end time: " << end_time;
-            std::cout << ", task position on machine: " << task_position;
-            std::cout << ", reticle usage: " << reticle_sharing << std::endl;
-
-            sol_file << job_id << "," << machine_id << "," << reticle_id << "," << transfer_time
-                     << "," << setup_time << "," << start_time << "," << processing_time << ","
-                     << end_time << "," << task_position << "," << reticle_sharing << std::endl;
-        }
+    for (const auto& task : schedule) {
+        std::cout << "Job " << task.job_id << " is processed on machine " << task.machine_id;
+        std::cout << " with reticle " << task.reticle_id;
+        std::cout << " with transfer time: " << task.transfer;
+        std::cout << ", setup time: " << task.setup;
+        std::cout << ", start time: " << task.start;
+        std::cout << ", duration: " << task.processing;
+        std::cout << ", end time: " << task.end;
+        std::cout << ", task position on machine: " << task.position;
+        std::cout << ", reticle usage: " << task.reticle_usage << std::endl;
+
+        sol_file << task.job_id << "," << task.machine_id << "," << task.reticle_id << ","
+                 << task.transfer << "," << task.setup << "," << task.start << ","
+                 << task.processing << "," << task.end << "," << task.position << ","
+                 << task.reticle_usage << std::endl;
     }
 
     // close the file
     sol_file.close();
 }
 
+void print_solution(const CpSolverResponse& response, const TaskVars& task_vars,
+                    const InstData& inst_data)
+{
+    auto schedule = extract_schedule(response, task_vars, inst_data);
+
+    for (const auto& task : schedule) {
+        if (task.end - task.start != task.processing) {
+            std::cout << "Error: processing time is not equal to the duration\n";
+            std::cout << "processing time: " << task.processing << std::endl;
+            std::cout << "start time: " << task.start << std::endl;
+            std::cout << "end time: " << task.end << std::endl;
+        }
+    }
+
+    print_schedule(schedule);
+}
+
 }   // namespace sat
 }   // namespace operations_research
@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "ortools/sat/cp_model.h"
+#include "ortools/sat/model.h"
+
+#include "telemetry.hpp"
+
+namespace operations_research {
+namespace sat {
+
+namespace {
+
+double relative_gap(int64_t objective, int64_t bound)
+{
+    if (objective < 0) {
+        return 1;
+    }
+    return objective > 0 ? std::max<double>(0, objective - bound) / objective : 0;
+}
+
+// the subsolver names are plain identifiers, but escape them anyway
+std::string json_string(const std::string& value)
+{
+    std::string escaped = "\"";
+    for (const char c : value) {
+        if (c == '"' or c == '\\') {
+            escaped += '\\';
+        }
+        if (c != '\n') {
+            escaped += c;
+        }
+    }
+    return escaped + "\"";
+}
+
+std::string csv_field(std::string value)
+{
+    std::replace(value.begin(), value.end(), ',', ' ');
+    std::replace(value.begin(), value.end(), '\n', ' ');
+    return value;
+}
+
+}   // namespace
+
+SolveTelemetry::SolveTelemetry(const std::string& file_name, int64_t lower_bound,
+                               double sample_interval)
+    : file_(file_name)
+    , json_lines_(file_name.ends_with(".jsonl"))
+    , start_time_(std::chrono::steady_clock::now())
+    , sample_interval_(sample_interval)
+    , bound_(lower_bound)
+{
+    if (!file_.is_open()) {
+        std::cerr << "Unable to open " << file_name << std::endl;
+    }
+    else if (!json_lines_) {
+        file_ << "time,event,objective,bound,gap,solutions,conflicts,subsolver\n";
+    }
+}
+
+SolveTelemetry::~SolveTelemetry()
+{
+    stop_sampling();
+}
+
+void SolveTelemetry::attach(Model& model)
+{
+    start_time_ = std::chrono::steady_clock::now();
+
+    model.Add(NewFeasibleSolutionObserver([this](const CpSolverResponse& response) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto time = elapsed();
+        objective_     = std::llround(response.objective_value());
+        bound_         = std::max(bound_,
+                                  static_cast<int64_t>(std::ceil(response.best_objective_bound())));
+        num_conflicts_ = std::max(num_conflicts_, response.num_conflicts());
+        num_solutions_++;
+        write_row({time,
+                   "solution",
+                   objective_,
+                   bound_,
+                   num_solutions_,
+                   num_conflicts_,
+                   response.solution_info()});
+    }));
+
+    model.Add(NewBestBoundCallback([this](double bound) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto time      = elapsed();
+        const auto new_bound = static_cast<int64_t>(std::ceil(bound));
+        if (new_bound <= bound_) {
+            return;   // not better than the bound known before the solve
+        }
+        bound_ = new_bound;
+        write_row({time, "bound", objective_, bound_, num_solutions_, num_conflicts_, ""});
+    }));
+
+    if (sample_interval_ > 0 and file_.is_open()) {
+        sampler_ = std::thread(&SolveTelemetry::sample_loop, this);
+    }
+}
+
+void SolveTelemetry::finish(const CpSolverResponse& response)
+{
+    stop_sampling();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (response.status() == CpSolverStatus::OPTIMAL or
+        response.status() == CpSolverStatus::FEASIBLE) {
+        objective_ = std::llround(response.objective_value());
+        bound_     = std::max(bound_,
+                              static_cast<int64_t>(std::ceil(response.best_objective_bound())));
+    }
+    num_conflicts_ = std::max(num_conflicts_, response.num_conflicts());
+    write_row({elapsed(),
+               "final",
+               objective_,
+               bound_,
+               num_solutions_,
+               num_conflicts_,
+               CpSolverStatus_Name(response.status())});
+}
+
+double SolveTelemetry::elapsed() const
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time_).count();
+}
+
+// a row every sample interval between the events, so that a solve without improvements still
+// shows up in the chart
+void SolveTelemetry::sample_loop()
+{
+    const std::chrono::duration<double> interval(sample_interval_);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_condition_.wait_for(lock, interval, [this] { return stopped_; })) {
+        write_row({elapsed(), "sample", objective_, bound_, num_solutions_, num_conflicts_, ""});
+    }
+}
+
+void SolveTelemetry::stop_sampling()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopped_ = true;
+    }
+    stop_condition_.notify_all();
+    if (sampler_.joinable()) {
+        sampler_.join();
+    }
+}
+
+void SolveTelemetry::write_row(const Row& row)
+{
+    const auto gap = relative_gap(row.objective, row.bound);
+    if (json_lines_) {
+        file_ << "{\"time\":" << row.time << ",\"event\":\"" << row.event
+              << "\",\"objective\":" << row.objective << ",\"bound\":" << row.bound
+              << ",\"gap\":" << gap << ",\"solutions\":" << row.num_solutions
+              << ",\"conflicts\":" << row.num_conflicts
+              << ",\"subsolver\":" << json_string(row.subsolver) << "}\n";
+    }
+    else {
+        file_ << row.time << "," << row.event << "," << row.objective << "," << row.bound << ","
+              << gap << "," << row.num_solutions << "," << row.num_conflicts << ","
+              << csv_field(row.subsolver) << "\n";
+    }
+    file_.flush();
+}
+
+}   // namespace sat
+}   // namespace operations_research
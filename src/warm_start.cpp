@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <iostream>
+
+#include "ortools/sat/cp_model.h"
+#include "ortools/sat/model.h"
+#include "ortools/sat/sat_parameters.pb.h"
+
+#include "build_model.hpp"
+#include "evaluator.hpp"
+#include "solve_model.hpp"
+#include "types.hpp"
+#include "warm_start.hpp"
+
+namespace operations_research {
+namespace sat {
+constexpr bool DEBUG = true;
+
+Schedule load_warm_start(const InstData& inst_data, const WarmStartOptions& options)
+{
+    const auto previous = read_schedule(options.file_name);
+
+    Schedule schedule;
+    int      dropped_jobs = 0;
+    for (auto task : previous) {
+        const TaskID task_id = {task.job_id, task.machine_id};
+        if (inst_data.processing_times.find(task_id) == inst_data.processing_times.end() or
+            task.start < options.time_shift) {
+            dropped_jobs++;
+            continue;
+        }
+        task.start -= options.time_shift;
+        task.end = task.start + inst_data.processing_times.at(task_id);
+        schedule.push_back(task);
+    }
+
+    // positions in the start order of the carried tasks on each machine
+    std::sort(schedule.begin(), schedule.end(), [](const auto& task1, const auto& task2) {
+        return std::make_pair(task1.machine_id, task1.start) <
+               std::make_pair(task2.machine_id, task2.start);
+    });
+    for (size_t i = 0; i < schedule.size(); ++i) {
+        const bool same_machine = i > 0 and schedule[i - 1].machine_id == schedule[i].machine_id;
+        schedule[i].position    = same_machine ? schedule[i - 1].position + 1 : 0;
+    }
+
+    if (DEBUG) {
+        std::cout << "Warm start: " << schedule.size() << " jobs carried over, " << dropped_jobs
+                  << " dropped from " << options.file_name << std::endl;
+    }
+
+    return schedule;
+}
+
+void add_warm_start(CpModelBuilder& cp_model, const TaskVars& task_vars,
+                    const Schedule& schedule, const WarmStartOptions& options)
+{
+    add_solution_hint(cp_model, task_vars, schedule);
+    if (options.freeze_until == 0) {
+        return;
+    }
+
+    // the frozen lots keep their machine and start, their setup, transfer, sharing count and
+    // arcs follow from the model since the previous ones may not hold in the new instance
+    int num_frozen = 0;
+    for (const auto& task : schedule) {
+        const TaskID task_id  = {task.job_id, task.machine_id};
+        const auto   presence = task_vars.task_presence_vars.find(task_id);
+        if (task.start >= options.freeze_until or presence == task_vars.task_presence_vars.end()) {
+            continue;
+        }
+        cp_model.AddEquality(presence->second, 1);
+        cp_model.AddEquality(task_vars.task_start_vars.at(task_id), task.start);
+        num_frozen++;
+    }
+
+    if (DEBUG) {
+        std::cout << "Warm start: " << num_frozen << " lots frozen before "
+                  << options.freeze_until << std::endl;
+    }
+}
+
+WarmStartReport compare_warm_start(const InstData& inst_data, const WarmStartOptions& options,
+                                   int num_search_workers, int time_limit)
+{
+    WarmStartReport report;
+    const auto      schedule = load_warm_start(inst_data, options);
+    report.carried_jobs      = schedule.size();
+    report.total_jobs        = inst_data.job_reticle_pairs.size();
+
+    for (const bool warm : {false, true}) {
+        CpModelBuilder      cp_model;
+        TaskVars            task_vars;
+        ModelIndex          model_index;
+        std::vector<IntVar> obj_exprs;
+        BuildOptions        build_options;
+        build_options.record_arc_literals = warm;
+        build_model(cp_model, task_vars, model_index, obj_exprs, inst_data, build_options);
+
+        Model         model;
+        SatParameters parameters;
+        set_time_limit(parameters, time_limit);
+        set_num_search_workers(parameters, num_search_workers);
+        parameters.set_stop_after_first_solution(true);
+        if (warm) {
+            add_warm_start(cp_model, task_vars, schedule, options);
+        }
+        add_parameters_to_model(model, parameters);
+
+        double  first_time  = -1;
+        int64_t first_value = -1;
+        model.Add(NewFeasibleSolutionObserver([&](const CpSolverResponse& response) {
+            if (first_time < 0) {
+                first_time  = response.wall_time();
+                first_value = static_cast<int64_t>(response.objective_value());
+            }
+        }));
+        solve_model(model, cp_model);
+
+        (warm ? report.warm_first_solution_time : report.cold_first_solution_time)   = first_time;
+        (warm ? report.warm_first_solution_value : report.cold_first_solution_value) = first_value;
+    }
+
+    return report;
+}
+
+void print_warm_start_report(const WarmStartReport& report)
+{
+    std::cout << "Carried jobs: " << report.carried_jobs << " / " << report.total_jobs
+              << std::endl;
+    std::cout << "Cold start, first solution: " << report.cold_first_solution_value << " after "
+              << report.cold_first_solution_time << " s" << std::endl;
+    std::cout << "Warm start, first solution: " << report.warm_first_solution_value << " after "
+              << report.warm_first_solution_time << " s" << std::endl;
+}
+
+}   // namespace sat
+}   // namespace operations_research